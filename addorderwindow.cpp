@@ -1,14 +1,27 @@
 #include <QtSql>
 #include <QTableView>
+#include <QTimer>
 #include "addorderwindow.h"
+#include "ordertablemodel.h"
+#include "partitions.h"
+#include "productsearchmodel.h"
 #include "ui_addorderwindow.h"
 #include "tools.h"
 
 AddOrderWindow::AddOrderWindow(QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::AddOrderWindow)
+    ui(new Ui::AddOrderWindow),
+    productsModel_(new ProductSearchModel(this)),
+    searchTimer_(new QTimer(this))
 {
     ui->setupUi(this);
+
+    // Wait until the user stops typing before querying the products table
+    searchTimer_->setSingleShot(true);
+    searchTimer_->setInterval(250);
+    connect(searchTimer_, &QTimer::timeout, this, &AddOrderWindow::searchProducts);
+    connect(ui->productSearchEdit, &QLineEdit::textChanged,
+            searchTimer_, static_cast<void (QTimer::*)()>(&QTimer::start));
 }
 
 AddOrderWindow::~AddOrderWindow()
@@ -16,102 +29,73 @@ AddOrderWindow::~AddOrderWindow()
     delete ui;
 }
 
-void AddOrderWindow::init(std::shared_ptr<QSqlRelationalTableModel> model,
+void AddOrderWindow::init(std::shared_ptr<OrderTableModel> model,
                           QTableView *tableView)
 {
-    //TODO: don't use a magical number,
-    //use  model_->fieldIndex("supplier") instead.
-    //but... http://stackoverflow.com/questions/41354212
-    int supplierIdx = 2;
-    int productIdx = 3;
-
     model_ = model;    
-    ui->supplierCombo->setModel(model_->relationModel(supplierIdx));
-    ui->supplierCombo->setModelColumn(model_->relationModel(supplierIdx)->fieldIndex("name"));
-    ui->productsView->setModel(model_->relationModel(productIdx));
-    ui->productsView->setModelColumn(model_->relationModel(productIdx)->fieldIndex("name"));
+    QSqlTableModel *suppliers = model_->relationModel(OrderTableModel::SupplierColumn);
+    ui->supplierCombo->setModel(suppliers);
+    ui->supplierCombo->setModelColumn(suppliers->fieldIndex("name"));
+
+    // The products catalog can be huge: the view is fed page by page
+    // by a type-ahead model instead of the whole products relation model
+    ui->productsView->setModel(productsModel_);
+    trackHotRow(ui->productsView, productsModel_);
     tableView_ = tableView;
 }
 
-void AddOrderWindow::on_buttonBox_accepted()
+void AddOrderWindow::searchProducts()
 {
-    //TODO: don't use a magical number,
-    //use  model_->fieldIndex("supplier") instead.
-    //but... http://stackoverflow.com/questions/41354212
-    int productIdx = 3;
-
-    QSqlRecord record = model_->record();
-
-    /*
-     * id serial, name varchar, supplier integer, product integer, year integer, rating integer
-     */
-    QSqlField f0("id", QVariant::Int);
-    QSqlField f1("name", QVariant::String);
-    QSqlField f2("supplier", QVariant::Int);
-    QSqlField f3("product", QVariant::Int);
-    QSqlField f4("year", QVariant::Int);
-    QSqlField f5("rating", QVariant::Int);
+    const QString prefix = ui->productSearchEdit->text().trimmed();
+    if (prefix != productsModel_->prefix())
+        productsModel_->setPrefix(prefix);
+}
 
-    // get next value for the id sequence
-    QSqlQuery q;
-    if(!q.exec("SELECT nextval(pg_get_serial_sequence('orders', 'id'))"))
-    {
-        showInfo(q.lastError().text());
+void AddOrderWindow::on_buttonBox_accepted()
+{
+    if (ui->productsView->selectionModel()->selectedIndexes().empty()) {
+        showInfo("Please, select a product.");
         return;
-    } else {
-        if (q.next()) {
-            int lastId = q.value(0).toInt();
-            f0.setValue(lastId);
-        }
-        else {
-            showInfo(q.lastError().text());
-            return;
-        }
     }
 
-    f1.setValue(QVariant(ui->nameEdit->text()));
-
     //Get the underlying index (not the visible text) for the combobox
     int row = ui->supplierCombo->currentIndex();
-    QModelIndex idx = ui->supplierCombo->model()->index(row, 0); // first combobox column (= the id)
-    QVariant data = ui->supplierCombo->model()->data(idx);
-    f2.setValue(QVariant(data.toInt()));
-
-
-    //Get the underlying index (not the visible text) for the listview
-    /*Same way than before...
-    row = ui->productsView->currentIndex().row();
-    idx = ui->productsView->model()->index(row, 0); // first listview column (= the id)
-    data = ui->productsView->model()->data(idx);
-    f3.setValue(QVariant(data.toInt()));
-    */
-
-    //Or...
-    QSqlRecord r = model_->relationModel(productIdx)->record(ui->productsView->currentIndex().row());
-    f3.setValue(QVariant(r.value("id").toInt()));
-
-    f4.setValue(QVariant(ui->yearSpinBox->value()));
-    f5.setValue(QVariant(ui->ratingSpinBox->value()));
-
-    if (ui->productsView->selectionModel()->selectedIndexes().empty()) {
-        showInfo("Please, select a product.");
-        return;
+    QSqlTableModel *suppliers = model_->relationModel(OrderTableModel::SupplierColumn);
+    QVariant supplierId = suppliers->index(row, suppliers->fieldIndex("id")).data();
+
+    QVariant productId = productsModel_->productId(ui->productsView->currentIndex().row());
+
+    // Give a new year its own partition. When the default partition
+    // already holds orders of that year the order goes there too, until
+    // the year is split from it (see MainWindow::splitYear()).
+    const int year = ui->yearSpinBox->value();
+    bool partitionCreated = false;
+    if (!defaultYears_.contains(year) && !hasOrderPartition(year)) {
+        if (!defaultPartitionHasYear(year)) {
+            QSqlError err = createOrderPartition(year);
+            partitionCreated = err.type() == QSqlError::NoError;
+            if (!partitionCreated)
+                qDebug() << Q_FUNC_INFO << err.text();
+        }
+        // the next orders of the year go to the default partition right away
+        if (!partitionCreated)
+            defaultYears_.insert(year);
     }
 
-    record.append(f0);
-    record.append(f1);
-    record.append(f2);
-    record.append(f3);
-    record.append(f4);
-    record.append(f5);
-
-    if (model_->insertRecord(-1, record))
+    // the id comes from the orders sequence
+    if (model_->insertOrder(ui->nameEdit->text(), year, supplierId, productId,
+                            ui->ratingSpinBox->value(), &row))
     {
         qDebug() << Q_FUNC_INFO << " OK ";
 
-        int lastRow = model_->rowCount() - 1;
-        tableView_->selectRow(lastRow);
-        tableView_->scrollToBottom();
+        if (partitionCreated)
+            emit orderPartitionCreated(year);
+
+        // not shown when the orders table is scoped to another year
+        if (row >= 0) {
+            tableView_->selectRow(row);
+            tableView_->scrollTo(model_->index(row, 0));
+        }
     } else {
         qDebug() << Q_FUNC_INFO << " NO OK " << model_->lastError().text();
     }
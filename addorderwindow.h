@@ -2,10 +2,13 @@
 #define ADDORDERWINDOW_H
 
 #include <memory>
+#include <QSet>
 #include <QWidget>
 
-class QSqlRelationalTableModel;
+class OrderTableModel;
 class QTableView;
+class QTimer;
+class ProductSearchModel;
 
 namespace Ui {
 class AddOrderWindow;
@@ -18,17 +21,26 @@ class AddOrderWindow : public QWidget
 public:
     explicit AddOrderWindow(QWidget *parent = 0);
     ~AddOrderWindow();
-    void init(std::shared_ptr<QSqlRelationalTableModel> model, QTableView *tableView);
+    void init(std::shared_ptr<OrderTableModel> model, QTableView *tableView);
+
+signals:
+    // A new year got its own partitions (see partitions.h)
+    void orderPartitionCreated(int year);
 
 private slots:
     void on_buttonBox_accepted();
 
     void on_buttonBox_rejected();
 
+    void searchProducts();
+
 private:
     Ui::AddOrderWindow *ui;
-    std::shared_ptr<QSqlRelationalTableModel> model_;
+    std::shared_ptr<OrderTableModel> model_;
     QTableView *tableView_;
+    ProductSearchModel *productsModel_;
+    QTimer *searchTimer_;
+    QSet<int> defaultYears_; // years left in the default partition
 };
 
 #endif // ADDORDERWINDOW_H
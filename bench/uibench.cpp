@@ -0,0 +1,218 @@
+/*
+ * UI benchmark: runs MainWindow on the offscreen platform against a
+ * generated set of orders and scripts scrolling, row selection changes
+ * and rating clicks on the orders table. For each scenario it prints the
+ * frame times, the time spent per BookDelegate::paint() call and the
+ * number of model fetches.
+ *
+ * It uses the same database as the application (see initdb.h), which is
+ * recreated on start.
+ *
+ *   uibench [--rows N] [--steps N]
+ */
+
+#include <algorithm>
+#include <QtSql>
+#include <QtTest>
+#include <QtWidgets>
+
+#include "bookdelegate.h"
+#include "mainwindow.h"
+#include "ordertablemodel.h"
+
+namespace {
+
+class TimedBookDelegate : public BookDelegate
+{
+public:
+    TimedBookDelegate(QObject *parent) : BookDelegate(parent), calls(0), nsecs(0) {}
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const Q_DECL_OVERRIDE
+    {
+        QElapsedTimer timer;
+        timer.start();
+        BookDelegate::paint(painter, option, index);
+        nsecs += timer.nsecsElapsed();
+        ++calls;
+    }
+
+    mutable qint64 calls;
+    mutable qint64 nsecs;
+};
+
+struct Scenario
+{
+    QString name;
+    QVector<qint64> frames; // nsecs
+    qint64 paintCalls = 0;
+    qint64 paintNsecs = 0;
+    int fetches = 0;
+};
+
+class FetchCounter : public QObject
+{
+public:
+    FetchCounter(QAbstractItemModel *model) : count(0)
+    {
+        // every fetchMore() and select() of the orders model shows up as one of these
+        connect(model, &QAbstractItemModel::rowsInserted, this, [this]() { ++count; });
+        connect(model, &QAbstractItemModel::modelReset, this, [this]() { ++count; });
+    }
+
+    int count;
+};
+
+double msecs(qint64 nsecs)
+{
+    return nsecs / 1000000.0;
+}
+
+void report(const Scenario &s)
+{
+    QVector<qint64> frames = s.frames;
+    std::sort(frames.begin(), frames.end());
+
+    qint64 total = 0;
+    for (qint64 f : frames)
+        total += f;
+
+    auto percentile = [&frames](double p) {
+        return frames.isEmpty() ? 0 : frames.at(qMin(frames.size() - 1, int(p * frames.size())));
+    };
+
+    printf("%-10s frames %5d  mean %8.3f ms  p50 %8.3f ms  p95 %8.3f ms  max %8.3f ms  "
+           "paint %8lld calls %7.2f us/call  fetches %d\n",
+           qPrintable(s.name), frames.size(),
+           frames.isEmpty() ? 0.0 : msecs(total / frames.size()),
+           msecs(percentile(0.50)), msecs(percentile(0.95)),
+           frames.isEmpty() ? 0.0 : msecs(frames.last()),
+           s.paintCalls, s.paintCalls ? s.paintNsecs / 1000.0 / s.paintCalls : 0.0,
+           s.fetches);
+}
+
+bool generateOrders(int rows)
+{
+    QSqlQuery q;
+    q.prepare(QLatin1String("INSERT INTO orders(name, year, supplier, product, rating) "
+                            "SELECT 'Order #' || g, 2012 + g % 4, 1 + g % 3, 1 + g % 3, g % 6 "
+                            "FROM generate_series(1, ?) g"));
+    q.addBindValue(rows);
+    if (!q.exec()) {
+        qWarning() << "Unable to generate the orders:" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// Repaints the table synchronously and returns the time it took
+qint64 frame(QTableView *table)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QCoreApplication::processEvents();
+    table->viewport()->repaint();
+    return timer.nsecsElapsed();
+}
+
+template <typename Step>
+Scenario run(const QString &name, QTableView *table, TimedBookDelegate *delegate,
+             int steps, Step step)
+{
+    Scenario s;
+    s.name = name;
+
+    FetchCounter fetches(table->model());
+    delegate->calls = 0;
+    delegate->nsecs = 0;
+
+    for (int i = 0; i < steps; ++i) {
+        step(i);
+        s.frames.append(frame(table));
+    }
+
+    s.paintCalls = delegate->calls;
+    s.paintNsecs = delegate->nsecs;
+    s.fetches = fetches.count;
+    return s;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    Q_INIT_RESOURCE(tarod_forms);
+
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    // same settings as the application, e.g. the replica (see dbrouter.h)
+    app.setOrganizationName("tarod");
+    app.setApplicationName("tarod-forms");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Orders table rendering and scrolling benchmark");
+    parser.addHelpOption();
+    QCommandLineOption rowsOption("rows", "Number of generated orders.", "N", "100000");
+    QCommandLineOption stepsOption("steps", "Scripted steps per scenario.", "N", "200");
+    parser.addOption(rowsOption);
+    parser.addOption(stepsOption);
+    parser.process(app);
+
+    const int rows = parser.value(rowsOption).toInt();
+    const int steps = parser.value(stepsOption).toInt();
+
+    // MainWindow recreates the database, the generated orders come after it
+    MainWindow win;
+    QTableView *table = win.findChild<QTableView *>("orderTable");
+    OrderTableModel *model = table ? qobject_cast<OrderTableModel *>(table->model()) : 0;
+    if (!model)
+        return 1;
+
+    // same sizing as the application, only timed
+    TimedBookDelegate *delegate = new TimedBookDelegate(table);
+    MainWindow::setSampledDelegate(table, delegate);
+
+    if (!generateOrders(rows))
+        return 1;
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!model->select()) {
+        qWarning() << "Unable to select the orders:" << model->lastError().text();
+        return 1;
+    }
+    printf("select     %d orders in %.3f ms (%d rows loaded)\n",
+           rows, msecs(timer.nsecsElapsed()), model->rowCount());
+
+    win.resize(1024, 768);
+    win.show();
+    if (!QTest::qWaitForWindowExposed(&win))
+        return 1;
+    frame(table);
+
+    QScrollBar *scrollBar = table->verticalScrollBar();
+    report(run("scroll", table, delegate, steps, [scrollBar](int) {
+        scrollBar->setValue(scrollBar->value() + scrollBar->pageStep());
+    }));
+
+    table->scrollToTop();
+    report(run("select", table, delegate, steps, [table, model](int i) {
+        table->selectRow(i % model->rowCount());
+    }));
+
+    table->scrollToTop();
+    const int ratingIdx = OrderTableModel::RatingColumn;
+    const int starWidth = delegate->starSize().width();
+    report(run("rating", table, delegate, steps, [table, model, ratingIdx, starWidth](int i) {
+        QModelIndex index = model->index(i % model->rowCount(), ratingIdx);
+        table->scrollTo(index);
+        QRect rect = table->visualRect(index);
+        // click in the middle of one of the stars, see BookDelegate::editorEvent()
+        QPoint pos(rect.x() + (i % 5) * starWidth + starWidth / 2, rect.center().y());
+        QTest::mouseClick(table->viewport(), Qt::LeftButton, Qt::NoModifier, pos);
+    }));
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+# UI rendering and scrolling benchmark of MainWindow (see uibench.cpp)
+TEMPLATE = app
+TARGET = uibench
+INCLUDEPATH += .
+
+include(../tarod-forms.pri)
+
+SOURCES     += uibench.cpp
+
+QT += testlib
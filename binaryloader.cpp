@@ -0,0 +1,202 @@
+#include <memory>
+#include <QtEndian>
+#include <QtSql>
+#include <libpq-fe.h>
+#include "binaryloader.h"
+
+namespace {
+
+// Type oids of the binary columns we decode (see pg_type)
+const Oid Int4Oid = 23;
+const Oid TextOid = 25;
+
+const int BinaryFormat = 1;
+
+QSqlError connectionError(const char *text, const QSqlDatabase &db)
+{
+    if (!db.isOpen())
+        return db.lastError();
+    return QSqlError(QLatin1String(text), QLatin1String("not a QPSQL connection"),
+                     QSqlError::ConnectionError);
+}
+
+PGconn *pgConnection(const QSqlDatabase &db)
+{
+    QVariant handle = db.driver() ? db.driver()->handle() : QVariant();
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "PGconn*") != 0)
+        return 0;
+
+    return *static_cast<PGconn **>(handle.data());
+}
+
+struct ResultDeleter
+{
+    void operator()(PGresult *result) const { PQclear(result); }
+};
+
+typedef std::unique_ptr<PGresult, ResultDeleter> Result;
+
+QSqlError resultError(const char *text, const PGresult *result)
+{
+    return QSqlError(QLatin1String(text),
+                     QString::fromUtf8(result ? PQresultErrorMessage(result) : ""),
+                     QSqlError::StatementError);
+}
+
+bool hasTypes(const PGresult *result, const QVector<Oid> &types)
+{
+    if (PQnfields(result) != types.size())
+        return false;
+    for (int column = 0; column < types.size(); ++column) {
+        if (PQftype(result, column) != types.at(column) || PQfformat(result, column) != BinaryFormat)
+            return false;
+    }
+    return true;
+}
+
+int int4Value(const PGresult *result, int row, int column)
+{
+    if (PQgetisnull(result, row, column))
+        return 0;
+    return qFromBigEndian<qint32>(reinterpret_cast<const uchar *>(PQgetvalue(result, row, column)));
+}
+
+QString textValue(const PGresult *result, int row, int column)
+{
+    if (PQgetisnull(result, row, column))
+        return QString();
+    // QPSQL sets the client encoding to UTF8
+    return QString::fromUtf8(PQgetvalue(result, row, column), PQgetlength(result, row, column));
+}
+
+// The orders matching conditions ($1... bound to values), with the names
+// of the relations, in (id, year) order
+QSqlError queryOrders(const QSqlDatabase &db, const QByteArray &conditions,
+                      const QList<QByteArray> &values, int limit, QVector<OrderRow> &rows)
+{
+    PGconn *conn = pgConnection(db);
+    if (!conn)
+        return connectionError("Unable to load the orders", db);
+
+    const QByteArray sql =
+            "SELECT o.id, o.name::text, o.supplier, s.name::text, o.product, p.name::text, o.year, o.rating "
+            "FROM orders o "
+            "LEFT JOIN suppliers s ON s.id = o.supplier "
+            "LEFT JOIN products p ON p.id = o.product "
+            "WHERE true" + conditions
+            + " ORDER BY o.id, o.year LIMIT " + QByteArray::number(limit);
+
+    QVector<const char *> params;
+    for (const QByteArray &value : values)
+        params.append(value.constData());
+
+    Result result(PQexecParams(conn, sql.constData(), params.size(), 0, params.constData(), 0, 0,
+                               BinaryFormat));
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK)
+        return resultError("Unable to load the orders", result.get());
+
+    const QVector<Oid> types = QVector<Oid>() << Int4Oid << TextOid << Int4Oid << TextOid
+                                              << Int4Oid << TextOid << Int4Oid << Int4Oid;
+    if (!hasTypes(result.get(), types))
+        return resultError("Unexpected orders columns", 0);
+
+    const int count = PQntuples(result.get());
+    rows.clear();
+    rows.reserve(count);
+    for (int row = 0; row < count; ++row) {
+        OrderRow order;
+        order.id = int4Value(result.get(), row, 0);
+        order.name = textValue(result.get(), row, 1);
+        order.supplierId = int4Value(result.get(), row, 2);
+        order.supplierName = textValue(result.get(), row, 3);
+        order.productId = int4Value(result.get(), row, 4);
+        order.productName = textValue(result.get(), row, 5);
+        order.year = int4Value(result.get(), row, 6);
+        order.rating = int4Value(result.get(), row, 7);
+        rows.append(order);
+    }
+
+    return QSqlError();
+}
+
+}
+
+QSqlError loadOrders(const QSqlDatabase &db, const QVariant &year, const OrderRow *after,
+                     int limit, QVector<OrderRow> &rows)
+{
+    QByteArray conditions;
+    QList<QByteArray> values;
+    // a constant year prunes the other partitions
+    if (year.isValid()) {
+        values << QByteArray::number(year.toInt());
+        conditions += " AND o.year = $" + QByteArray::number(values.size());
+    }
+    if (after) {
+        values << QByteArray::number(after->id) << QByteArray::number(after->year);
+        conditions += " AND (o.id, o.year) > ($" + QByteArray::number(values.size() - 1)
+                + ", $" + QByteArray::number(values.size()) + ')';
+    }
+
+    return queryOrders(db, conditions, values, limit, rows);
+}
+
+QSqlError loadOrder(const QSqlDatabase &db, int id, int year, OrderRow &order)
+{
+    QVector<OrderRow> rows;
+    QSqlError err = queryOrders(db, " AND o.id = $1 AND o.year = $2",
+                                QList<QByteArray>() << QByteArray::number(id) << QByteArray::number(year),
+                                1, rows);
+    if (err.type() != QSqlError::NoError)
+        return err;
+    if (rows.isEmpty())
+        return QSqlError(QLatin1String("Unable to load the order"),
+                         QLatin1String("no such order"), QSqlError::StatementError);
+
+    order = rows.first();
+    return QSqlError();
+}
+
+QSqlError loadOrderItems(const QSqlDatabase &db, int orderId, int orderYear,
+                         QVector<OrderItemRow> &rows)
+{
+    PGconn *conn = pgConnection(db);
+    if (!conn)
+        return connectionError("Unable to load the order items", db);
+
+    // the order year prunes the partitions of both tables
+    const char *sql =
+            "SELECT i.product_id, p.name::text, i.order_id, i.order_year, o.name::text, i.quantity "
+            "FROM order_items i "
+            "LEFT JOIN products p ON p.id = i.product_id "
+            "JOIN orders o ON o.id = i.order_id AND o.year = i.order_year "
+            "WHERE i.order_id = $1 AND i.order_year = $2 AND o.year = $2 "
+            "ORDER BY i.product_id";
+
+    const QByteArray id = QByteArray::number(orderId);
+    const QByteArray year = QByteArray::number(orderYear);
+    const char *params[] = { id.constData(), year.constData() };
+
+    Result result(PQexecParams(conn, sql, 2, 0, params, 0, 0, BinaryFormat));
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK)
+        return resultError("Unable to load the order items", result.get());
+
+    const QVector<Oid> types = QVector<Oid>() << Int4Oid << TextOid << Int4Oid << Int4Oid << TextOid << Int4Oid;
+    if (!hasTypes(result.get(), types))
+        return resultError("Unexpected order items columns", 0);
+
+    const int count = PQntuples(result.get());
+    rows.clear();
+    rows.reserve(count);
+    for (int row = 0; row < count; ++row) {
+        OrderItemRow item;
+        item.productId = int4Value(result.get(), row, 0);
+        item.productName = textValue(result.get(), row, 1);
+        item.orderId = int4Value(result.get(), row, 2);
+        item.orderYear = int4Value(result.get(), row, 3);
+        item.orderName = textValue(result.get(), row, 4);
+        item.quantity = int4Value(result.get(), row, 5);
+        rows.append(item);
+    }
+
+    return QSqlError();
+}
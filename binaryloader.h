@@ -0,0 +1,55 @@
+#ifndef BINARYLOADER_H
+#define BINARYLOADER_H
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+/*
+ * Loaders for the fixed schemas of initdb.h that bypass QSqlQuery: the
+ * query runs through the libpq connection of a QPSQL database, asks for
+ * binary results and decodes each column straight into typed rows,
+ * without the text parsing and the QVariant/QSqlRecord per cell.
+ *
+ * Use them on DbRouter::loaderDatabase(): libpq would hand the
+ * notifications of a subscribed connection to the loaders, not the driver.
+ */
+
+struct OrderRow
+{
+    int id;
+    QString name;
+    int supplierId; // 0 when there is none
+    QString supplierName;
+    int productId;  // 0 when there is none
+    QString productName;
+    int year;
+    int rating;
+};
+
+struct OrderItemRow
+{
+    int productId;
+    QString productName;
+    int orderId;
+    int orderYear;
+    QString orderName;
+    int quantity;
+};
+
+// One page of at most limit orders in (id, year) order, with the names of
+// the relations. Only the orders of year when it is valid, and only the
+// ones after the given row when it is not null (keyset pagination).
+QSqlError loadOrders(const QSqlDatabase &db, const QVariant &year, const OrderRow *after,
+                     int limit, QVector<OrderRow> &rows);
+
+// The order of the given key, as loadOrders() would return it
+QSqlError loadOrder(const QSqlDatabase &db, int id, int year, OrderRow &order);
+
+// Items of one order, with the product and order names of the relations
+QSqlError loadOrderItems(const QSqlDatabase &db, int orderId, int orderYear,
+                         QVector<OrderItemRow> &rows);
+
+#endif // BINARYLOADER_H
@@ -49,11 +49,23 @@
 ****************************************************************************/
 
 #include "bookdelegate.h"
+#include "ordertablemodel.h"
 
+#include <QtSql>
 #include <QtWidgets>
 
+namespace {
+
+QSqlTableModel *relationModel(const QModelIndex &index)
+{
+    const OrderTableModel *model = qobject_cast<const OrderTableModel *>(index.model());
+    return model ? model->relationModel(index.column()) : 0;
+}
+
+}
+
 BookDelegate::BookDelegate(QObject *parent)
-    : QSqlRelationalDelegate(parent), star(QPixmap(":images/star.png"))
+    : QSqlRelationalDelegate(parent), star(QPixmap(":images/star.png")), sampleRows(0)
 {
 }
 
@@ -93,6 +105,33 @@ void BookDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
 
 QSize BookDelegate::sizeHint(const QStyleOptionViewItem &option,
                                  const QModelIndex &index) const
+{
+    if (sampleRows > 0 && index.isValid())
+        return sampledSizeHint(option, index);
+
+    return cellSizeHint(option, index);
+}
+
+void BookDelegate::setSampledSizing(int sampleRows)
+{
+    this->sampleRows = qMax(0, sampleRows);
+    clearSizeHintCache();
+}
+
+void BookDelegate::clearSizeHintCache()
+{
+    sizeHintCache.clear();
+}
+
+int BookDelegate::uniformRowHeight(const QStyleOptionViewItem &option) const
+{
+    const QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+    const int margin = style->pixelMetric(QStyle::PM_FocusFrameVMargin, &option, option.widget) + 1;
+    return qMax(option.fontMetrics.height() + 2 * margin, star.height()) + 1; // since we draw the grid ourselves
+}
+
+QSize BookDelegate::cellSizeHint(const QStyleOptionViewItem &option,
+                                 const QModelIndex &index) const
 {
     if (index.column() == 5)
         return QSize(5 * star.width(), star.height()) + QSize(1, 1);
@@ -100,6 +139,41 @@ QSize BookDelegate::sizeHint(const QStyleOptionViewItem &option,
     return QSqlRelationalDelegate::sizeHint(option, index) + QSize(1, 1); // since we draw the grid ourselves
 }
 
+QSize BookDelegate::sampledSizeHint(const QStyleOptionViewItem &option,
+                                    const QModelIndex &index) const
+{
+    const int column = index.column();
+    QHash<int, QSize>::const_iterator it = sizeHintCache.constFind(column);
+    if (it != sizeHintCache.constEnd())
+        return it.value();
+
+    // rowCount() only counts the rows already fetched, so the sample
+    // never forces the model to load more data
+    const QAbstractItemModel *model = index.model();
+    const int rows = qMin(sampleRows, model->rowCount(index.parent()));
+
+    QSize size(0, uniformRowHeight(option));
+    for (int row = 0; row < rows; ++row) {
+        const QModelIndex sample = model->index(row, column, index.parent());
+        size.setWidth(qMax(size.width(), cellSizeHint(option, sample).width()));
+    }
+
+    const QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+    const int margin = style->pixelMetric(QStyle::PM_FocusFrameHMargin, &option, option.widget) + 1;
+    const QString header = model->headerData(column, Qt::Horizontal).toString();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    const int headerWidth = option.fontMetrics.horizontalAdvance(header);
+#else
+    const int headerWidth = option.fontMetrics.width(header);
+#endif
+    size.setWidth(qMax(size.width(), headerWidth + 2 * margin + 1));
+
+    // a short table may still grow, only a full sample is worth keeping
+    if (rows == sampleRows)
+        sizeHintCache.insert(column, size);
+    return size;
+}
+
 bool BookDelegate::editorEvent(QEvent *event, QAbstractItemModel *model,
                                const QStyleOptionViewItem &option,
                                const QModelIndex &index)
@@ -121,6 +195,13 @@ bool BookDelegate::editorEvent(QEvent *event, QAbstractItemModel *model,
 QWidget *BookDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &option,
                                     const QModelIndex &index) const
 {
+    if (QSqlTableModel *relation = relationModel(index)) {
+        QComboBox *combo = new QComboBox(parent);
+        combo->setModel(relation);
+        combo->setModelColumn(relation->fieldIndex("name"));
+        return combo;
+    }
+
     if (index.column() != 4)
         return QSqlRelationalDelegate::createEditor(parent, option, index);
 
@@ -133,3 +214,35 @@ QWidget *BookDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem
     return sb;
 }
 
+void BookDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
+{
+    QComboBox *combo = qobject_cast<QComboBox *>(editor);
+    QSqlTableModel *relation = relationModel(index);
+    if (!combo || !relation) {
+        QSqlRelationalDelegate::setEditorData(editor, index);
+        return;
+    }
+
+    const QModelIndexList matches = relation->match(relation->index(0, relation->fieldIndex("id")),
+                                                    Qt::EditRole, index.data(Qt::EditRole), 1,
+                                                    Qt::MatchExactly);
+    combo->setCurrentIndex(matches.isEmpty() ? -1 : matches.first().row());
+}
+
+void BookDelegate::setModelData(QWidget *editor, QAbstractItemModel *model,
+                                const QModelIndex &index) const
+{
+    QComboBox *combo = qobject_cast<QComboBox *>(editor);
+    QSqlTableModel *relation = relationModel(index);
+    if (!combo || !relation) {
+        QSqlRelationalDelegate::setModelData(editor, model, index);
+        return;
+    }
+
+    const int row = combo->currentIndex();
+    if (row < 0)
+        return;
+
+    model->setData(index, relation->index(row, relation->fieldIndex("id")).data(Qt::EditRole),
+                   Qt::EditRole);
+}
@@ -51,6 +51,7 @@
 #ifndef BOOKDELEGATE_H
 #define BOOKDELEGATE_H
 
+#include <QHash>
 #include <QModelIndex>
 #include <QPixmap>
 #include <QSize>
@@ -75,8 +76,31 @@ public:
     QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option,
                                         const QModelIndex &index) const Q_DECL_OVERRIDE;
 
+    // The relation columns of OrderTableModel are edited with a combo box
+    // of the related names, which writes the id of the related row
+    void setEditorData(QWidget *editor, const QModelIndex &index) const Q_DECL_OVERRIDE;
+    void setModelData(QWidget *editor, QAbstractItemModel *model,
+                      const QModelIndex &index) const Q_DECL_OVERRIDE;
+
+    // Size columns from the header and the first sampleRows rows only, and
+    // cache the result per column. 0 (the default) sizes every cell.
+    void setSampledSizing(int sampleRows);
+    static const int DefaultSampleRows = 50;
+    void clearSizeHintCache();
+
+    // Height that fits any cell, to be used as a fixed row height
+    int uniformRowHeight(const QStyleOptionViewItem &option) const;
+
+    // One of the five stars of the rating column
+    QSize starSize() const { return star.size(); }
+
 private:
+    QSize cellSizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const;
+    QSize sampledSizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const;
+
     QPixmap star;
+    int sampleRows;
+    mutable QHash<int, QSize> sizeHintCache;
 };
 
 #endif
@@ -0,0 +1,159 @@
+#include <QtSql>
+#include "dbrouter.h"
+
+namespace {
+
+const char *const ReplicaConnection = "replica";
+const char *const ModelConnection = "reader";
+const char *const LoaderConnection = "loader";
+
+// How often the replay position of a lagging replica is checked
+const int ReplicaCheckInterval = 500; // msecs
+
+bool routing = false;
+bool modelsOnPrimary = false;
+
+// WAL position of our last write not yet replayed by the replica
+QString pendingLsn;
+QTimer *replicaTimer = 0;
+
+void copyConnection(QSqlDatabase &db, const QSqlDatabase &from)
+{
+    db.setHostName(from.hostName());
+    db.setPort(from.port());
+    db.setDatabaseName(from.databaseName());
+    db.setUserName(from.userName());
+    db.setPassword(from.password());
+    db.setConnectOptions(from.connectOptions());
+}
+
+}
+
+QSqlError DbRouter::init()
+{
+    QSettings settings;
+    settings.beginGroup("replica");
+    const QString host = settings.value("host").toString();
+    if (host.isEmpty())
+        return QSqlError();
+
+    QSqlDatabase primaryDb = primary();
+    QSqlDatabase replica = QSqlDatabase::addDatabase("QPSQL", ReplicaConnection);
+    replica.setHostName(host);
+    replica.setPort(settings.value("port", 5432).toInt());
+    replica.setDatabaseName(settings.value("database", primaryDb.databaseName()).toString());
+    replica.setUserName(settings.value("user", primaryDb.userName()).toString());
+    replica.setPassword(settings.value("password", primaryDb.password()).toString());
+    if (!replica.open())
+        return replica.lastError();
+
+    QSqlDatabase reader = QSqlDatabase::cloneDatabase(replica, ModelConnection);
+    if (!reader.open())
+        return reader.lastError();
+
+    replicaTimer = new QTimer(QCoreApplication::instance());
+    replicaTimer->setInterval(ReplicaCheckInterval);
+    QObject::connect(replicaTimer, &QTimer::timeout, &DbRouter::checkReplica);
+
+    routing = true;
+    modelsOnPrimary = false;
+
+    // initDb() may just have written the schema
+    noteWrite();
+    checkReplica();
+    refreshModelDatabase();
+
+    return QSqlError();
+}
+
+bool DbRouter::isRouting()
+{
+    return routing;
+}
+
+QSqlDatabase DbRouter::primary()
+{
+    return QSqlDatabase::database();
+}
+
+QSqlDatabase DbRouter::readDatabase()
+{
+    if (!routing || !replicaCaughtUp())
+        return primary();
+
+    return QSqlDatabase::database(ReplicaConnection);
+}
+
+QSqlDatabase DbRouter::loaderDatabase()
+{
+    if (routing && replicaCaughtUp())
+        return QSqlDatabase::database(ReplicaConnection);
+
+    if (!QSqlDatabase::contains(LoaderConnection))
+        QSqlDatabase::cloneDatabase(primary(), LoaderConnection);
+
+    return QSqlDatabase::database(LoaderConnection);
+}
+
+QSqlDatabase DbRouter::modelDatabase()
+{
+    return routing ? QSqlDatabase::database(ModelConnection) : primary();
+}
+
+bool DbRouter::refreshModelDatabase()
+{
+    if (!routing)
+        return false;
+
+    const bool usePrimary = !replicaCaughtUp();
+    if (usePrimary == modelsOnPrimary)
+        return false;
+
+    // The models share this connection: reopening it invalidates their
+    // queries, which is why they have to be selected again
+    QSqlDatabase reader = QSqlDatabase::database(ModelConnection, false);
+    reader.close();
+    copyConnection(reader, usePrimary ? primary() : QSqlDatabase::database(ReplicaConnection, false));
+    if (!reader.open()) {
+        qDebug() << Q_FUNC_INFO << reader.lastError().text();
+        return false;
+    }
+
+    modelsOnPrimary = usePrimary;
+    return true;
+}
+
+void DbRouter::noteWrite()
+{
+    if (!routing)
+        return;
+
+    QSqlQuery q(primary());
+    if (q.exec(QLatin1String("SELECT pg_current_wal_lsn()")) && q.next()) {
+        pendingLsn = q.value(0).toString();
+        replicaTimer->start();
+    }
+}
+
+bool DbRouter::replicaCaughtUp()
+{
+    // the answer of the last checkReplica()
+    return pendingLsn.isEmpty();
+}
+
+void DbRouter::checkReplica()
+{
+    if (pendingLsn.isEmpty()) {
+        replicaTimer->stop();
+        return;
+    }
+
+    QSqlQuery q(QSqlDatabase::database(ReplicaConnection));
+    q.prepare(QLatin1String("SELECT pg_last_wal_replay_lsn() >= ?::pg_lsn"));
+    q.addBindValue(pendingLsn);
+    if (!q.exec() || !q.next() || !q.value(0).toBool())
+        return;
+
+    pendingLsn.clear();
+    replicaTimer->stop();
+}
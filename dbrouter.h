@@ -0,0 +1,62 @@
+#ifndef DBROUTER_H
+#define DBROUTER_H
+
+#include <QSqlDatabase>
+#include <QSqlError>
+
+/*
+ * Routes the reads to a streaming replica and the writes to the primary
+ * (the default connection opened by initDb()).
+ *
+ * The replica is configured in the application settings:
+ *
+ *   [replica]
+ *   host=...        ; routing is enabled when set
+ *   port=5432
+ *   database=...    ; defaults to the primary's
+ *   user=...
+ *   password=...
+ *
+ * Routing is lag aware: after a write, reads go to the primary until the
+ * replica has replayed the WAL position of that write, so the client
+ * always reads its own writes. The replica is asked about it on a timer
+ * while it lags, never on the way of a read.
+ */
+class DbRouter
+{
+public:
+    // Opens the replica connections when a replica is configured.
+    // On error the reads stay on the primary.
+    static QSqlError init();
+    static bool isRouting();
+
+    // Connection for the writes
+    static QSqlDatabase primary();
+
+    // Connection for one-off read queries: the replica when it is fresh,
+    // the primary otherwise
+    static QSqlDatabase readDatabase();
+
+    // Same as readDatabase() for the binary loaders (see binaryloader.h),
+    // but never the primary connection subscribed to the notifications:
+    // on the primary they get a connection of their own.
+    static QSqlDatabase loaderDatabase();
+
+    // Connection the long lived models are created on. Their queries stay
+    // open, so it is only switched by refreshModelDatabase().
+    static QSqlDatabase modelDatabase();
+
+    // Points modelDatabase() at the primary while the replica lags, and
+    // back at the replica once it caught up. Returns true when it switched:
+    // every model on it must be selected again.
+    static bool refreshModelDatabase();
+
+    // To be called after each write on the primary
+    static void noteWrite();
+
+private:
+    static bool replicaCaughtUp();
+    static void checkReplica();
+};
+
+#endif // DBROUTER_H
@@ -53,6 +53,8 @@
 
 #include <QtSql>
 
+#include "partitions.h"
+
 QVariant addOrder(QSqlQuery &q, const QString &name, int year, const QVariant &supplierId,
              const QVariant &productId, int rating)
 {
@@ -81,10 +83,12 @@ QVariant addSupplier(QSqlQuery &q, const QString &name, const QDate &created)
     return q.lastInsertId();
 }
 
-void addOrderItem(QSqlQuery &q, const QVariant &productId, const QVariant &orderId, int quantity)
+void addOrderItem(QSqlQuery &q, const QVariant &productId, const QVariant &orderId, int orderYear,
+                  int quantity)
 {
     q.addBindValue(productId);
     q.addBindValue(orderId);
+    q.addBindValue(orderYear);
     q.addBindValue(quantity);
     q.exec();
 }
@@ -100,33 +104,66 @@ QSqlError initDb()
     if (!db.open())
         return db.lastError();
 
+    // Changing the year of an order moves it to another partition. Before
+    // PostgreSQL 15 that move is a DELETE and an INSERT, which the foreign
+    // key of order_items rejects instead of cascading the new year.
+    QSqlQuery qVersion;
+    if (!qVersion.exec(QLatin1String("SHOW server_version_num")) || !qVersion.next())
+        return qVersion.lastError();
+    if (qVersion.value(0).toInt() < 150000)
+        return QSqlError(QString(), QObject::tr("PostgreSQL 15 or later is required"),
+                         QSqlError::ConnectionError);
+
     /* TESTING */
     // TODO: remove after testing    
     QSqlQuery qTesting;
     if (!qTesting.exec(QLatin1String("DROP TABLE IF EXISTS orders, suppliers, products, order_items")))
         return qTesting.lastError();
+    if (!qTesting.exec(QLatin1String("DROP SCHEMA IF EXISTS archive CASCADE")))
+        return qTesting.lastError();
 
 
-    QStringList tables = db.tables();
-    if (tables.contains("orders", Qt::CaseInsensitive)
-        && tables.contains("suppliers", Qt::CaseInsensitive))
+    // db.tables() does not list partitioned tables
+    QSqlQuery qExists;
+    if (qExists.exec(QLatin1String("SELECT to_regclass('orders') IS NOT NULL AND to_regclass('suppliers') IS NOT NULL"))
+        && qExists.next() && qExists.value(0).toBool())
         return QSqlError();
 
     QSqlQuery q;
-    if (!q.exec(QLatin1String("CREATE TABLE orders(id SERIAL PRIMARY KEY, name varchar, supplier integer, product integer, year integer, rating integer)")))
+    // orders are partitioned by year, so queries scoped to a year only scan its partition
+    if (!q.exec(QLatin1String("CREATE TABLE orders(id SERIAL, name varchar, supplier integer, product integer, year integer NOT NULL, rating integer,"
+                              "PRIMARY KEY (id, year)"
+                              ") PARTITION BY RANGE (year)")))
+        return q.lastError();
+    if (!q.exec(QLatin1String("CREATE TABLE orders_default PARTITION OF orders DEFAULT")))
         return q.lastError();
     if (!q.exec(QLatin1String("CREATE TABLE suppliers(id SERIAL PRIMARY KEY, name varchar, created date)")))
         return q.lastError();
     if (!q.exec(QLatin1String("CREATE TABLE products(id SERIAL PRIMARY KEY, name varchar, price numeric)")))
         return q.lastError();
-    // now, the many-to-many relationships between tables orders and products
+    // type-ahead lookups by name prefix, in pages (see ProductSearchModel)
+    if (!q.exec(QLatin1String("CREATE INDEX products_name_key_idx ON products((lower(name)) COLLATE \"C\", id)")))
+        return q.lastError();
+    // now, the many-to-many relationships between tables orders and products,
+    // partitioned like the orders they belong to
     if (!q.exec(QLatin1String("CREATE TABLE order_items("
                               "product_id integer REFERENCES products,"
-                              "order_id integer REFERENCES orders,"
+                              "order_id integer,"
+                              "order_year integer NOT NULL,"
                               "quantity integer,"
-                              "PRIMARY KEY (product_id, order_id)"
-                              ")")))
+                              "PRIMARY KEY (product_id, order_id, order_year),"
+                              "CONSTRAINT order_items_order_fkey FOREIGN KEY (order_id, order_year)"
+                              // needs PostgreSQL 15 when the year moves the order to another partition
+                              " REFERENCES orders(id, year) ON UPDATE CASCADE"
+                              ") PARTITION BY RANGE (order_year)")))
+        return q.lastError();
+    if (!q.exec(QLatin1String("CREATE TABLE order_items_default PARTITION OF order_items DEFAULT")))
         return q.lastError();
+    for (int year = 2012; year <= 2015; ++year) {
+        QSqlError err = createOrderPartition(year);
+        if (err.type() != QSqlError::NoError)
+            return err;
+    }
 
     if (!q.prepare(QLatin1String("insert into suppliers(name, created) values(?, ?)")))
         return q.lastError();
@@ -156,17 +193,22 @@ QSqlError initDb()
     QVariant order12 = addOrder(q, QLatin1String("Night Watch"), 2014, supplier3Id, product3, 3);
     QVariant order13 = addOrder(q, QLatin1String("Going Postal"), 2015, supplier3Id, product3, 3);
 
-    if (!q.prepare(QLatin1String("insert into order_items(product_id, order_id, quantity) values(?, ?, ?)")))
+    if (!q.prepare(QLatin1String("insert into order_items(product_id, order_id, order_year, quantity) values(?, ?, ?, ?)")))
+        return q.lastError();
+    addOrderItem(q, product1, order1, 2012, 1);
+    addOrderItem(q, product2, order2, 2012, 2);
+    addOrderItem(q, product3, order3, 2012, 3);
+    addOrderItem(q, product1, order4, 2012, 4);
+    addOrderItem(q, product2, order4, 2012, 5);
+    addOrderItem(q, product3, order4, 2012, 6);
+
+    // Notifications (a statement trigger on the partitioned table fires once per UPDATE)
+    if (!q.exec(QLatin1String("CREATE OR REPLACE FUNCTION notify_dbupdated() RETURNS trigger AS $$"
+                              " BEGIN NOTIFY dbupdated; RETURN NULL; END"
+                              " $$ LANGUAGE plpgsql")))
         return q.lastError();
-    addOrderItem(q, product1, order1, 1);
-    addOrderItem(q, product2, order2, 2);
-    addOrderItem(q, product3, order3, 3);
-    addOrderItem(q, product1, order4, 4);
-    addOrderItem(q, product2, order4, 5);
-    addOrderItem(q, product3, order4, 6);
-
-    // Notifications
-    if (!q.exec(QLatin1String("DROP RULE IF EXISTS notifications ON orders; CREATE RULE notifications AS ON UPDATE TO orders DO NOTIFY dbupdated")))
+    if (!q.exec(QLatin1String("CREATE TRIGGER notifications AFTER UPDATE ON orders"
+                              " FOR EACH STATEMENT EXECUTE PROCEDURE notify_dbupdated()")))
         return q.lastError();
 
     return QSqlError();
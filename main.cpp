@@ -57,6 +57,8 @@ int main(int argc, char * argv[])
     Q_INIT_RESOURCE(tarod_forms);
 
     QApplication app(argc, argv);
+    app.setOrganizationName("tarod");
+    app.setApplicationName("tarod-forms");
 
     MainWindow win;
     win.show();
@@ -1,7 +1,11 @@
 #include "mainwindow.h"
 #include "addorderwindow.h"
 #include "bookdelegate.h"
+#include "dbrouter.h"
 #include "initdb.h"
+#include "memorybudget.h"
+#include "orderitemsmodel.h"
+#include "ordertablemodel.h"
 #include "tools.h"
 
 MainWindow::MainWindow(): addOrderWindow_(new AddOrderWindow(this))
@@ -26,37 +30,32 @@ MainWindow::MainWindow(): addOrderWindow_(new AddOrderWindow(this))
         return;
     }
 
+    // Send the reads to the replica, if any. Without it everything stays on the primary.
+    err = DbRouter::init();
+    if (err.type() != QSqlError::NoError)
+        showError(err);
+
     // Subscribe to the notification "dbupdated" (created in postgresql -- see initdb.h)
     QSqlDatabase::database().driver()->subscribeToNotification("dbupdated");
 
     connect(QSqlDatabase::database().driver(), SIGNAL(notification(const QString&)),
             this, SLOT(notificationHandler(const QString&)));
 
-    // Create the data model for orders table
-    orderModel_ = std::shared_ptr<QSqlRelationalTableModel>(new QSqlRelationalTableModel(ui.orderTable));
-    //TODO: confirm! orderModel_->setEditStrategy(QSqlTableModel::OnManualSubmit);
-    orderModel_->setEditStrategy(QSqlTableModel::OnFieldChange);
-    orderModel_->setTable("orders");
+    // Create the data model for orders table. The rows are loaded from
+    // binary results with the supplier and product names of the relations,
+    // every edit is written to the primary right away (see ordertablemodel.h)
+    orderModel_ = std::shared_ptr<OrderTableModel>(new OrderTableModel(ui.orderTable));
 
     // Remember the indexes of the columns
-    orderIdx_ = orderModel_->fieldIndex("id");
-    supplierIdx_ = orderModel_->fieldIndex("supplier");
-    productIdx_ = orderModel_->fieldIndex("product");
-
-    // Set the relations to the other database tables
-    /*
-     * The QSqlRelation class stores information about an
-     * SQL foreign key.
-     */
-    orderModel_->setRelation(supplierIdx_, QSqlRelation("suppliers", "id", "name"));
-    orderModel_->setRelation(productIdx_, QSqlRelation("products", "id", "name"));
+    orderIdx_ = OrderTableModel::IdColumn;
+    supplierIdx_ = OrderTableModel::SupplierColumn;
+    productIdx_ = OrderTableModel::ProductColumn;
+    yearIdx_ = OrderTableModel::YearColumn;
 
-    // Set the localized header captions
-    orderModel_->setHeaderData(supplierIdx_, Qt::Horizontal, tr("Supplier"));
-    orderModel_->setHeaderData(productIdx_, Qt::Horizontal, tr("Product"));
-    orderModel_->setHeaderData(orderModel_->fieldIndex("name"), Qt::Horizontal, tr("Name"));
-    orderModel_->setHeaderData(orderModel_->fieldIndex("year"), Qt::Horizontal, tr("Year"));
-    orderModel_->setHeaderData(orderModel_->fieldIndex("rating"), Qt::Horizontal, tr("Rating"));
+    // A page that fails to load is tried again on the next scroll
+    connect(orderModel_.get(), &OrderTableModel::loadFailed, this, [this](const QSqlError &err) {
+        statusBar()->showMessage(tr("Unable to load the orders: %1").arg(err.text()));
+    });
 
     // Populate the model
     if (!orderModel_->select()) {
@@ -66,9 +65,10 @@ MainWindow::MainWindow(): addOrderWindow_(new AddOrderWindow(this))
 
     // Set the model and hide the ID column
     ui.orderTable->setModel(orderModel_.get());
-    ui.orderTable->setItemDelegate(new BookDelegate(ui.orderTable));
-    ui.orderTable->setColumnHidden(orderModel_->fieldIndex("id"), true);
-    ui.orderTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    setSampledDelegate(ui.orderTable, new BookDelegate(ui.orderTable));
+    ui.orderTable->setColumnHidden(orderIdx_, true);
+    ui.orderTable->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    ui.orderTable->resizeColumnsToContents();
 
     // Initialize the supplier combo box with the model
     ui.supplierEdit->setModel(orderModel_->relationModel(supplierIdx_));
@@ -81,11 +81,11 @@ MainWindow::MainWindow(): addOrderWindow_(new AddOrderWindow(this))
     QDataWidgetMapper *mapper = new QDataWidgetMapper(this);
     mapper->setModel(orderModel_.get());
     mapper->setItemDelegate(new BookDelegate(this));
-    mapper->addMapping(ui.orderEdit, orderModel_->fieldIndex("name"));
-    mapper->addMapping(ui.yearEdit, orderModel_->fieldIndex("year"));
+    mapper->addMapping(ui.orderEdit, OrderTableModel::NameColumn);
+    mapper->addMapping(ui.yearEdit, yearIdx_);
     mapper->addMapping(ui.supplierEdit, supplierIdx_);
     mapper->addMapping(ui.productEdit, productIdx_);
-    mapper->addMapping(ui.ratingEdit, orderModel_->fieldIndex("rating"));
+    mapper->addMapping(ui.ratingEdit, OrderTableModel::RatingColumn);
 
     connect(ui.orderTable->selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)),
             mapper, SLOT(setCurrentModelIndex(QModelIndex)));
@@ -95,14 +95,27 @@ MainWindow::MainWindow(): addOrderWindow_(new AddOrderWindow(this))
     // Initialize the products view with the model
     initProductsView();
 
+    // Initialize the year scope selector with the partitioned years
+    initYearScope();
+
     // Init the Add Order Window with the model and the view
     addOrderWindow_->init(orderModel_, ui.orderTable);
 
+    // A new order may have brought a new year in
+    connect(addOrderWindow_.get(), &AddOrderWindow::orderPartitionCreated,
+            this, &MainWindow::initYearScope);
+
     connect(ui.orderTable->selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)),
             this, SLOT(showOrderItemsDetails(QModelIndex)));
 
     connect(ui.addOrderButton, &QPushButton::clicked,
             this, &MainWindow::addOrder);
+    connect(ui.bulkSupplierButton, &QPushButton::clicked,
+            this, &MainWindow::setSelectedSupplier);
+    connect(ui.bulkRatingButton, &QPushButton::clicked,
+            this, &MainWindow::setSelectedRating);
+
+    initMemoryAccounting();
 
     createMenuBar();
 }
@@ -113,48 +126,158 @@ MainWindow::~MainWindow()
 
 void MainWindow::initProductsView()
 {
-    // Create the data model for order_items table
-    orderItemsModel_ = std::shared_ptr<QSqlRelationalTableModel>(new QSqlRelationalTableModel(ui.productsView));
-    orderItemsModel_->setTable("order_items");
+    // Create the data model for order_items table. It is loaded from
+    // binary results, with the product and order names of the relations
+    // (see binaryloader.h); the quantities can be edited
+    orderItemsModel_ = std::shared_ptr<OrderItemsModel>(new OrderItemsModel(ui.productsView));
 
-    // Remember the indexes of the columns
-    ordersIdx_ = orderItemsModel_->fieldIndex("order_id");
-    productsIdx_ = orderItemsModel_->fieldIndex("product_id");
+    // Set the model
+    ui.productsView->setModel(orderItemsModel_.get());
+    setSampledDelegate(ui.productsView, new BookDelegate(ui.productsView));
 
-    // Set the relations to the other database tables.
-    // The next colums are foreign keys and the view
-    // should present the name fields instead of the ids
-    // (order_id and product_id)
-    /*
-     * The QSqlRelation class stores information about an
-     * SQL foreign key.
-     */
-    orderItemsModel_->setRelation(ordersIdx_, QSqlRelation("orders", "id", "name"));
-    orderItemsModel_->setRelation(productsIdx_, QSqlRelation("products", "id", "name"));
+    // Show only the items of the order selected in orders table
+    showOrderItems(ui.orderTable->currentIndex().row());
+}
 
-    // Populate the model
-    if (!orderItemsModel_->select()) {
-        showError(orderItemsModel_->lastError());
+void MainWindow::showOrderItems(int row)
+{
+    QModelIndex orderIndex = ui.orderTable->model()->index(row, orderIdx_);
+    QModelIndex yearIndex = ui.orderTable->model()->index(row, yearIdx_);
+
+    // the order year lets the query skip the partitions of other years
+    if (!orderItemsModel_->setOrder(orderIndex.data().toInt(), yearIndex.data().toInt()))
+        qDebug() << Q_FUNC_INFO << orderItemsModel_->lastError().text();
+}
+
+void MainWindow::showOrderItemsDetails(const QModelIndex &index)
+{
+    // Filter the model to show only the order id selected in orders table
+    showOrderItems(index.row());
+}
+
+void MainWindow::initYearScope()
+{
+    // Keep the year shown by the orders table, if it is still there
+    QVariant current = ui.yearScopeCombo->currentData();
+
+    ui.yearScopeCombo->blockSignals(true);
+    ui.yearScopeCombo->clear();
+    ui.yearScopeCombo->addItem(tr("All years"));
+    for (int year : orderPartitionYears(DbRouter::readDatabase()))
+        ui.yearScopeCombo->addItem(QString::number(year), year);
+    ui.yearScopeCombo->setCurrentIndex(current.isValid() ? qMax(0, ui.yearScopeCombo->findData(current))
+                                                         : 0);
+    ui.yearScopeCombo->blockSignals(false);
+
+    connect(ui.yearScopeCombo, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(setYearScope(int)), Qt::UniqueConnection);
+}
+
+void MainWindow::setYearScope(int index)
+{
+    QVariant year = ui.yearScopeCombo->itemData(index);
+
+    // A constant year lets PostgreSQL prune the other partitions
+    if (!orderModel_->setYear(year)) {
+        showError(orderModel_->lastError());
         return;
     }
 
-    // Set the model
-    ui.productsView->setModel(orderItemsModel_.get());
+    ui.orderTable->setCurrentIndex(orderModel_->index(0, 0));
+}
 
-    // Filter the model to show only the order id selected in orders table
-    int row = ui.orderTable->currentIndex().row();
-    QModelIndex index = ui.orderTable->model()->index(row,
-                                                      0); // 0 = the id in orders table
-    orderItemsModel_->setFilter("order_id = '" + index.data().toString() + '\'') ;
+void MainWindow::archiveYear()
+{
+    QVariant year = ui.yearScopeCombo->currentData();
+    if (!year.isValid()) {
+        showInfo(tr("Please, select the year to archive."));
+        return;
+    }
+
+    if (QMessageBox::question(this, tr("Archive year"),
+                              tr("Move the orders of %1 to the archive?").arg(year.toInt()))
+            != QMessageBox::Yes)
+        return;
+
+    QSqlError err = archiveOrderPartition(year.toInt());
+    if (err.type() != QSqlError::NoError) {
+        showError(err);
+        return;
+    }
+    DbRouter::noteWrite();
+
+    initYearScope();
+    setYearScope(0);
 }
 
-void MainWindow::showOrderItemsDetails(const QModelIndex &index)
+void MainWindow::splitYear()
 {
-    // Filter the model to show only the order id selected in orders table
-    int row = index.row();
-    QModelIndex orderIndex = ui.orderTable->model()->index(row,
-                                                             0); // 0 = the id in orders table
-    orderItemsModel_->setFilter("order_id = '" + orderIndex.data().toString() + '\'') ;
+    bool ok = false;
+    int year = QInputDialog::getInt(this, tr("Partition year"),
+                                    tr("Year to move out of the default partition:"),
+                                    QDate::currentDate().year(), -1000, 2100, 1, &ok);
+    if (!ok)
+        return;
+
+    if (hasOrderPartition(year)) {
+        showInfo(tr("The orders of %1 already have their own partition.").arg(year));
+        return;
+    }
+
+    if (QMessageBox::question(this, tr("Partition year"),
+                              tr("Move the orders of %1 to a partition of their own? "
+                                 "The orders table is locked meanwhile.").arg(year))
+            != QMessageBox::Yes)
+        return;
+
+    QSqlError err = splitOrderPartition(year);
+    if (err.type() != QSqlError::NoError) {
+        showError(err);
+        return;
+    }
+    DbRouter::noteWrite();
+
+    initYearScope();
+}
+
+void MainWindow::setSampledDelegate(QTableView *view, BookDelegate *delegate)
+{
+    delegate->setSampledSizing(BookDelegate::DefaultSampleRows);
+
+    // The cached column widths are only valid for the current result set
+    connect(view->model(), &QAbstractItemModel::modelReset,
+            delegate, [delegate]() { delegate->clearSizeHintCache(); });
+
+    // Fixed rows: the view never asks the delegate for row heights
+    QStyleOptionViewItem option;
+    option.initFrom(view);
+    view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    view->verticalHeader()->setDefaultSectionSize(delegate->uniformRowHeight(option));
+
+    view->setItemDelegate(delegate);
+}
+
+void MainWindow::initMemoryAccounting()
+{
+    // The models account for themselves (see memorybudget.h). The orders
+    // keep the rows up to the ones shown or selected.
+    trackHotRow(ui.orderTable, orderModel_.get());
+
+    memoryLabel_ = new QLabel(this);
+    statusBar()->addPermanentWidget(memoryLabel_);
+    connect(MemoryBudget::instance(), &MemoryBudget::usageChanged,
+            this, &MainWindow::showMemoryUsage);
+}
+
+void MainWindow::showMemoryUsage(qint64 usage, qint64 budget)
+{
+    const double MB = 1024 * 1024;
+    memoryLabel_->setText(tr("Memory: %1 / %2 MB").arg(usage / MB, 0, 'f', 1).arg(budget / MB, 0, 'f', 0));
+
+    QStringList lines;
+    for (const QPair<QString, qint64> &account : MemoryBudget::instance()->usageByAccount())
+        lines << tr("%1: %2 KB").arg(account.first).arg(account.second / 1024);
+    memoryLabel_->setToolTip(lines.join('\n'));
 }
 
 void MainWindow::about()
@@ -170,6 +293,67 @@ void MainWindow::addOrder()
     addOrderWindow_->show();
 }
 
+QList<int> MainWindow::selectedOrderRows() const
+{
+    QList<int> rows;
+    for (const QModelIndex &index : ui.orderTable->selectionModel()->selectedRows())
+        rows.append(index.row());
+    return rows;
+}
+
+void MainWindow::setSelectedSupplier()
+{
+    QList<int> rows = selectedOrderRows();
+    if (rows.isEmpty()) {
+        showInfo(tr("Please, select the orders to change."));
+        return;
+    }
+
+    QSqlTableModel *suppliers = orderModel_->relationModel(supplierIdx_);
+
+    // Supplier names are not unique: the combo box gives the row, and
+    // the row the id
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Set supplier"));
+    QComboBox *combo = new QComboBox(&dialog);
+    combo->setModel(suppliers);
+    combo->setModelColumn(suppliers->fieldIndex("name"));
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel,
+                                                     &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel(tr("Supplier of the %n selected order(s):", 0, rows.size()), &dialog));
+    layout->addWidget(combo);
+    layout->addWidget(buttons);
+
+    if (dialog.exec() != QDialog::Accepted || combo->currentIndex() < 0)
+        return;
+
+    const QSqlRecord supplier = suppliers->record(combo->currentIndex());
+    if (!orderModel_->updateRows(rows, supplierIdx_, supplier.value("id"), supplier.value("name")))
+        showError(orderModel_->lastError());
+}
+
+void MainWindow::setSelectedRating()
+{
+    QList<int> rows = selectedOrderRows();
+    if (rows.isEmpty()) {
+        showInfo(tr("Please, select the orders to change."));
+        return;
+    }
+
+    bool ok = false;
+    int rating = QInputDialog::getInt(this, tr("Set rating"),
+                                      tr("Rating of the %n selected order(s):", 0, rows.size()),
+                                      3, 0, 5, 1, &ok);
+    if (!ok)
+        return;
+
+    if (!orderModel_->updateRows(rows, OrderTableModel::RatingColumn, rating))
+        showError(orderModel_->lastError());
+}
+
 void MainWindow::notificationHandler(const QString &name)
 {    
     qDebug() << Q_FUNC_INFO;
@@ -186,6 +370,8 @@ void MainWindow::createMenuBar()
 {
     QAction *productsAction = new QAction(tr("&Products..."), this);
     QAction *suppliersAction = new QAction(tr("&Suppliers..."), this);
+    QAction *archiveAction = new QAction(tr("A&rchive year..."), this);
+    QAction *splitAction = new QAction(tr("Pa&rtition year..."), this);
     QAction *quitAction = new QAction(tr("&Exit"), this);
     QAction *aboutAction = new QAction(tr("&About"), this);
 
@@ -197,6 +383,9 @@ void MainWindow::createMenuBar()
     fileMenu->addAction(productsAction);
     fileMenu->addAction(suppliersAction);
     fileMenu->addSeparator();
+    fileMenu->addAction(splitAction);
+    fileMenu->addAction(archiveAction);
+    fileMenu->addSeparator();
     fileMenu->addAction(quitAction);
 
     QMenu *helpMenu = menuBar()->addMenu(tr("&Ayuda"));
@@ -204,6 +393,8 @@ void MainWindow::createMenuBar()
 
     connect(productsAction, SIGNAL(triggered(bool)), this, SLOT(addAlbum()));
     connect(suppliersAction, SIGNAL(triggered(bool)), this, SLOT(deleteAlbum()));
+    connect(archiveAction, SIGNAL(triggered(bool)), this, SLOT(archiveYear()));
+    connect(splitAction, SIGNAL(triggered(bool)), this, SLOT(splitYear()));
     connect(quitAction, SIGNAL(triggered(bool)), this, SLOT(close()));
     connect(aboutAction, SIGNAL(triggered(bool)), this, SLOT(about()));
 }
@@ -8,6 +8,9 @@
 #include "ui_mainwindow.h"
 
 class AddOrderWindow;
+class BookDelegate;
+class OrderItemsModel;
+class OrderTableModel;
 
 class MainWindow: public QMainWindow
 {
@@ -16,8 +19,15 @@ public:
     MainWindow();
     ~MainWindow();
 
+    // Installs delegate on view with sampled column sizing and fixed rows
+    static void setSampledDelegate(QTableView *view, BookDelegate *delegate);
+
 private:    
     void initProductsView();
+    void initYearScope();
+    void showOrderItems(int row);
+    QList<int> selectedOrderRows() const;
+    void initMemoryAccounting();
     void createMenuBar();
     void showError(const QSqlError &err);    
 
@@ -26,14 +36,20 @@ private slots:
     void addOrder();
     void notificationHandler(const QString &name);
     void showOrderItemsDetails(const QModelIndex &index);
+    void setYearScope(int index);
+    void archiveYear();
+    void splitYear();
+    void setSelectedSupplier();
+    void setSelectedRating();
+    void showMemoryUsage(qint64 usage, qint64 budget);
 
 private:
     Ui::MainWindow ui;
     std::unique_ptr<AddOrderWindow> addOrderWindow_;
-    std::shared_ptr<QSqlRelationalTableModel> orderModel_;
-    std::shared_ptr<QSqlRelationalTableModel> orderItemsModel_;
-    int orderIdx_, supplierIdx_, productIdx_;
-    int ordersIdx_, productsIdx_;
+    std::shared_ptr<OrderTableModel> orderModel_;
+    std::shared_ptr<OrderItemsModel> orderItemsModel_;
+    int orderIdx_, supplierIdx_, productIdx_, yearIdx_;
+    QLabel *memoryLabel_;
 };
 
 #endif
@@ -0,0 +1,151 @@
+#include <QtSql>
+#include "memorybudget.h"
+
+namespace {
+
+// Rows looked at to estimate the size of a row of a SQL model
+const int SampleRows = 32;
+
+qint64 variantSize(const QVariant &value)
+{
+    qint64 size = sizeof(QVariant);
+    if (value.type() == QVariant::String)
+        size += value.toString().capacity() * sizeof(QChar);
+    else if (value.type() == QVariant::ByteArray)
+        size += value.toByteArray().capacity();
+    return size;
+}
+
+}
+
+MemoryAccount::~MemoryAccount()
+{
+    MemoryBudget::instance()->removeAccount(this);
+}
+
+qint64 MemoryAccount::evictableMemory() const
+{
+    return 0;
+}
+
+qint64 MemoryAccount::evictMemory(qint64 bytes)
+{
+    Q_UNUSED(bytes);
+    return 0;
+}
+
+QueryModelAccount::QueryModelAccount(const QString &name, QSqlQueryModel *model) :
+    name_(name),
+    model_(model)
+{
+}
+
+qint64 QueryModelAccount::memoryUsage() const
+{
+    if (!model_)
+        return 0;
+
+    // the driver may hold more rows than the model fetched so far
+    const int rows = qMax(model_->query().size(), model_->rowCount());
+    const int sampled = qMin(rows, model_->rowCount());
+    if (sampled == 0)
+        return 0;
+
+    qint64 bytes = 0;
+    for (int row = 0; row < qMin(sampled, SampleRows); ++row) {
+        const QSqlRecord record = model_->record(row);
+        for (int column = 0; column < record.count(); ++column)
+            bytes += variantSize(record.value(column));
+    }
+
+    return bytes * rows / qMin(sampled, SampleRows);
+}
+
+MemoryBudget *MemoryBudget::instance()
+{
+    // outlives the accounts, which remove themselves on destruction
+    static MemoryBudget budget;
+    return &budget;
+}
+
+MemoryBudget::MemoryBudget(QObject *parent) :
+    QObject(parent),
+    enforceScheduled_(false)
+{
+    QSettings settings;
+    budget_ = settings.value("memory/budgetMB", 256).toLongLong() * 1024 * 1024;
+}
+
+void MemoryBudget::addAccount(MemoryAccount *account)
+{
+    if (!accounts_.contains(account))
+        accounts_.append(account);
+    scheduleEnforce();
+}
+
+void MemoryBudget::removeAccount(MemoryAccount *account)
+{
+    accounts_.removeAll(account);
+}
+
+void MemoryBudget::touch(MemoryAccount *account)
+{
+    if (accounts_.removeAll(account))
+        accounts_.append(account);
+}
+
+void MemoryBudget::setBudget(qint64 bytes)
+{
+    budget_ = bytes;
+    scheduleEnforce();
+}
+
+qint64 MemoryBudget::usage() const
+{
+    qint64 bytes = 0;
+    for (const MemoryAccount *account : accounts_)
+        bytes += account->memoryUsage();
+    return bytes;
+}
+
+QList<QPair<QString, qint64> > MemoryBudget::usageByAccount() const
+{
+    QList<QPair<QString, qint64> > usage;
+    for (const MemoryAccount *account : accounts_)
+        usage.append(qMakePair(account->memoryName(), account->memoryUsage()));
+    return usage;
+}
+
+void MemoryBudget::scheduleEnforce()
+{
+    // models report their loads while views are still using them:
+    // never evict from under a caller, and check once per batch of loads
+    if (enforceScheduled_)
+        return;
+
+    enforceScheduled_ = true;
+    QMetaObject::invokeMethod(this, "enforce", Qt::QueuedConnection);
+}
+
+void MemoryBudget::enforce()
+{
+    enforceScheduled_ = false;
+
+    qint64 bytes = usage();
+    if (bytes > budget_) {
+        qint64 evictable = 0;
+        for (const MemoryAccount *account : accounts_)
+            evictable += account->evictableMemory();
+
+        if (bytes - evictable <= budget_) {
+            const QList<MemoryAccount *> accounts = accounts_;
+            for (MemoryAccount *account : accounts) {
+                if (bytes <= budget_)
+                    break;
+                bytes -= account->evictMemory(bytes - budget_);
+            }
+        }
+    }
+
+    emit usageChanged(bytes, budget_);
+}
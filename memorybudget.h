@@ -0,0 +1,89 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QString>
+
+class QSqlQueryModel;
+
+/*
+ * Something that holds data in memory: a model, a cache...
+ * It reports an estimate of its usage and, if it can, evicts cold data.
+ */
+class MemoryAccount
+{
+public:
+    virtual ~MemoryAccount();
+
+    virtual QString memoryName() const = 0;
+    virtual qint64 memoryUsage() const = 0;
+
+    // Cold data evictMemory() could free right now
+    virtual qint64 evictableMemory() const;
+
+    // Frees at least bytes of cold data if possible; returns the bytes freed
+    virtual qint64 evictMemory(qint64 bytes);
+};
+
+// Estimates a SQL model from a sample of its rows. Nothing can be evicted
+// by default: the rows are held by the driver's result set.
+class QueryModelAccount : public MemoryAccount
+{
+public:
+    QueryModelAccount(const QString &name, QSqlQueryModel *model);
+
+    QString memoryName() const Q_DECL_OVERRIDE { return name_; }
+    qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
+private:
+    QString name_;
+    QPointer<QSqlQueryModel> model_;
+};
+
+/*
+ * Global memory budget of the application, read from the "memory/budgetMB"
+ * setting (256 MB by default). When the accounts exceed it, cold data is
+ * evicted starting with the least recently used accounts, but only if
+ * that gets them back under the budget: short of it, the evicted data
+ * would just be loaded again.
+ */
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MemoryBudget *instance();
+
+    void addAccount(MemoryAccount *account);
+    void removeAccount(MemoryAccount *account);
+
+    // Marks the account as the most recently used one
+    void touch(MemoryAccount *account);
+
+    qint64 budget() const { return budget_; }
+    void setBudget(qint64 bytes);
+
+    qint64 usage() const;
+    QList<QPair<QString, qint64> > usageByAccount() const;
+
+    // Checks the budget once control returns to the event loop
+    void scheduleEnforce();
+
+public slots:
+    void enforce();
+
+signals:
+    void usageChanged(qint64 usage, qint64 budget);
+
+private:
+    explicit MemoryBudget(QObject *parent = 0);
+
+    QList<MemoryAccount *> accounts_; // least recently used first
+    qint64 budget_;
+    bool enforceScheduled_;
+};
+
+#endif // MEMORYBUDGET_H
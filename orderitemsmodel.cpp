@@ -0,0 +1,119 @@
+#include <QtSql>
+#include "dbrouter.h"
+#include "orderitemsmodel.h"
+
+OrderItemsModel::OrderItemsModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    MemoryBudget::instance()->addAccount(this);
+}
+
+bool OrderItemsModel::setOrder(int orderId, int orderYear)
+{
+    QVector<OrderItemRow> items;
+    lastError_ = loadOrderItems(DbRouter::loaderDatabase(), orderId, orderYear, items);
+
+    beginResetModel();
+    items_.swap(items);
+    endResetModel();
+
+    MemoryBudget::instance()->touch(this);
+    MemoryBudget::instance()->scheduleEnforce();
+
+    return lastError_.type() == QSqlError::NoError;
+}
+
+qint64 OrderItemsModel::memoryUsage() const
+{
+    qint64 bytes = items_.capacity() * sizeof(OrderItemRow);
+    for (const OrderItemRow &item : items_)
+        bytes += (item.productName.capacity() + item.orderName.capacity()) * sizeof(QChar);
+    return bytes;
+}
+
+int OrderItemsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : items_.size();
+}
+
+int OrderItemsModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant OrderItemsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= items_.size())
+        return QVariant();
+
+    const OrderItemRow &item = items_.at(index.row());
+    if (role == Qt::DisplayRole || role == Qt::EditRole) {
+        switch (index.column()) {
+        case ProductColumn:
+            return item.productName;
+        case OrderColumn:
+            return item.orderName;
+        case QuantityColumn:
+            return item.quantity;
+        }
+    } else if (role == Qt::UserRole) {
+        // the foreign keys behind the names
+        switch (index.column()) {
+        case ProductColumn:
+            return item.productId;
+        case OrderColumn:
+            return item.orderId;
+        }
+    }
+
+    return QVariant();
+}
+
+bool OrderItemsModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::EditRole || !(flags(index) & Qt::ItemIsEditable))
+        return false;
+
+    OrderItemRow &item = items_[index.row()];
+    QSqlQuery q(DbRouter::primary());
+    q.prepare(QLatin1String("UPDATE order_items SET quantity = ? "
+                            "WHERE product_id = ? AND order_id = ? AND order_year = ?"));
+    q.addBindValue(value.toInt());
+    q.addBindValue(item.productId);
+    q.addBindValue(item.orderId);
+    q.addBindValue(item.orderYear);
+    if (!q.exec()) {
+        lastError_ = q.lastError();
+        return false;
+    }
+    DbRouter::noteWrite();
+
+    item.quantity = value.toInt();
+    emit dataChanged(index, index);
+    return true;
+}
+
+Qt::ItemFlags OrderItemsModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags flags = QAbstractTableModel::flags(index);
+    if (index.isValid() && index.column() == QuantityColumn)
+        flags |= Qt::ItemIsEditable;
+    return flags;
+}
+
+QVariant OrderItemsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section) {
+    case ProductColumn:
+        return tr("Product");
+    case OrderColumn:
+        return tr("Order");
+    case QuantityColumn:
+        return tr("Quantity");
+    }
+
+    return QVariant();
+}
@@ -0,0 +1,45 @@
+#ifndef ORDERITEMSMODEL_H
+#define ORDERITEMSMODEL_H
+
+#include <QAbstractTableModel>
+#include <QSqlError>
+#include <QVector>
+
+#include "binaryloader.h"
+#include "memorybudget.h"
+
+/*
+ * Model of the items of one order, filled by loadOrderItems() (see
+ * binaryloader.h) from the connection the reads are routed to. Only the
+ * quantity is editable: an edit is one UPDATE on the primary, then the
+ * row is patched in place.
+ */
+class OrderItemsModel : public QAbstractTableModel, public MemoryAccount
+{
+    Q_OBJECT
+
+public:
+    enum Column { ProductColumn, OrderColumn, QuantityColumn, ColumnCount };
+
+    explicit OrderItemsModel(QObject *parent = 0);
+
+    bool setOrder(int orderId, int orderYear);
+    QSqlError lastError() const { return lastError_; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) Q_DECL_OVERRIDE;
+    Qt::ItemFlags flags(const QModelIndex &index) const Q_DECL_OVERRIDE;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+
+    QString memoryName() const Q_DECL_OVERRIDE { return tr("Order items"); }
+    qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
+private:
+    QVector<OrderItemRow> items_;
+    QSqlError lastError_;
+};
+
+#endif // ORDERITEMSMODEL_H
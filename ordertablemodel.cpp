@@ -0,0 +1,442 @@
+#include <QtSql>
+#include "dbrouter.h"
+#include "ordertablemodel.h"
+
+namespace {
+
+// The orders field of each column
+const char *const Fields[] = { "id", "name", "supplier", "product", "year", "rating" };
+
+// Every view and combo box (editors included) set on a model listens to
+// its modelReset(): while one does, the model is in use
+class RelationModel : public QSqlTableModel
+{
+public:
+    RelationModel(QObject *parent, const QSqlDatabase &db) :
+        QSqlTableModel(parent, db),
+        attached_(0)
+    {
+    }
+
+    bool isAttached() const { return attached_ > 0; }
+
+protected:
+    void connectNotify(const QMetaMethod &signal) Q_DECL_OVERRIDE
+    {
+        if (signal == QMetaMethod::fromSignal(&QAbstractItemModel::modelReset))
+            ++attached_;
+    }
+
+    void disconnectNotify(const QMetaMethod &signal) Q_DECL_OVERRIDE
+    {
+        if (signal == QMetaMethod::fromSignal(&QAbstractItemModel::modelReset))
+            --attached_;
+    }
+
+private:
+    int attached_;
+};
+
+// A relation model no widget uses can be cleared whole:
+// OrderTableModel::relationModel() selects it again when it is needed
+class RelationAccount : public QueryModelAccount
+{
+public:
+    RelationAccount(const QString &name, RelationModel *model) :
+        QueryModelAccount(name, model),
+        model_(model)
+    {
+        MemoryBudget::instance()->addAccount(this);
+    }
+
+    qint64 evictableMemory() const Q_DECL_OVERRIDE
+    {
+        return model_->isAttached() ? 0 : memoryUsage();
+    }
+
+    qint64 evictMemory(qint64 bytes) Q_DECL_OVERRIDE
+    {
+        Q_UNUSED(bytes);
+        const qint64 freed = evictableMemory();
+        if (freed > 0)
+            model_->clear();
+        return freed;
+    }
+
+private:
+    RelationModel *model_;
+};
+
+}
+
+OrderTableModel::OrderTableModel(QObject *parent) :
+    QAbstractTableModel(parent),
+    atEnd_(true),
+    bytes_(0),
+    hotRow_(0),
+    suppliers_(new RelationModel(this, DbRouter::modelDatabase())),
+    products_(new RelationModel(this, DbRouter::modelDatabase())),
+    suppliersAccount_(new RelationAccount(tr("Suppliers"), static_cast<RelationModel *>(suppliers_))),
+    productsAccount_(new RelationAccount(tr("Products"), static_cast<RelationModel *>(products_)))
+{
+    suppliers_->setTable("suppliers");
+    products_->setTable("products");
+
+    MemoryBudget::instance()->addAccount(this);
+}
+
+bool OrderTableModel::setYear(const QVariant &year)
+{
+    year_ = year;
+    return select();
+}
+
+QSqlTableModel *OrderTableModel::relationModel(int column) const
+{
+    QSqlTableModel *model = 0;
+    MemoryAccount *account = 0;
+    const char *table = 0;
+    switch (column) {
+    case SupplierColumn:
+        model = suppliers_;
+        account = suppliersAccount_.get();
+        table = "suppliers";
+        break;
+    case ProductColumn:
+        model = products_;
+        account = productsAccount_.get();
+        table = "products";
+        break;
+    default:
+        return 0;
+    }
+
+    // cleared by RelationAccount::evictMemory()
+    if (model->tableName().isEmpty()) {
+        model->setTable(table);
+        if (!model->select())
+            qDebug() << Q_FUNC_INFO << model->lastError().text();
+        MemoryBudget::instance()->scheduleEnforce();
+    }
+
+    MemoryBudget::instance()->touch(account);
+    return model;
+}
+
+bool OrderTableModel::updateRows(const QList<int> &rows, int column, const QVariant &value,
+                                 const QVariant &displayValue)
+{
+    if (rows.isEmpty())
+        return true;
+    if (column <= IdColumn || column >= ColumnCount)
+        return false;
+
+    QStringList ids;
+    for (int row : rows)
+        ids << QString::number(orders_.at(row).id);
+
+    QSqlDatabase db = DbRouter::primary();
+    if (!db.transaction()) {
+        lastError_ = db.lastError();
+        return false;
+    }
+
+    QSqlQuery q(db);
+    q.prepare(QString("UPDATE orders SET %1 = ? WHERE id = ANY(?::integer[])").arg(Fields[column]));
+    q.addBindValue(value);
+    q.addBindValue('{' + ids.join(',') + '}');
+
+    if (!q.exec()) {
+        lastError_ = q.lastError();
+        db.rollback();
+        return false;
+    }
+
+    if (!db.commit()) {
+        lastError_ = db.lastError();
+        return false;
+    }
+    DbRouter::noteWrite();
+
+    const QString name = displayValue.isValid() ? displayValue.toString() : relationName(column, value);
+    for (int row : rows) {
+        OrderRow &order = orders_[row];
+        bytes_ -= orderSize(order);
+        setValue(order, column, value, name);
+        bytes_ += orderSize(order);
+        emit dataChanged(index(row, column), index(row, column));
+    }
+
+    return true;
+}
+
+bool OrderTableModel::insertOrder(const QString &name, int year, const QVariant &supplierId,
+                                  const QVariant &productId, int rating, int *row)
+{
+    if (row)
+        *row = -1;
+    lastError_ = QSqlError();
+
+    QSqlQuery q(DbRouter::primary());
+    q.prepare(QLatin1String("INSERT INTO orders(name, supplier, product, year, rating) "
+                            "VALUES (?, ?, ?, ?, ?) RETURNING id"));
+    q.addBindValue(name);
+    q.addBindValue(supplierId);
+    q.addBindValue(productId);
+    q.addBindValue(year);
+    q.addBindValue(rating);
+    if (!q.exec() || !q.next()) {
+        lastError_ = q.lastError();
+        return false;
+    }
+    const int id = q.value(0).toInt();
+    DbRouter::noteWrite();
+
+    // The new order has the newest id, so it comes after all the loaded
+    // rows: until the last page is loaded the paging brings it in
+    if (!atEnd_ || (year_.isValid() && year_.toInt() != year))
+        return true;
+
+    OrderRow order;
+    lastError_ = loadOrder(DbRouter::loaderDatabase(), id, year, order);
+    if (lastError_.type() != QSqlError::NoError)
+        return false;
+
+    beginInsertRows(QModelIndex(), orders_.size(), orders_.size());
+    orders_.append(order);
+    bytes_ += orderSize(order);
+    endInsertRows();
+
+    if (row)
+        *row = orders_.size() - 1;
+    return true;
+}
+
+int OrderTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : orders_.size();
+}
+
+int OrderTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant OrderTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= orders_.size())
+        return QVariant();
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+        return QVariant();
+
+    // the views show the names of the relations, the editors change their ids
+    const OrderRow &order = orders_.at(index.row());
+    switch (index.column()) {
+    case IdColumn:
+        return order.id;
+    case NameColumn:
+        return order.name;
+    case SupplierColumn:
+        if (role == Qt::EditRole)
+            return order.supplierId ? QVariant(order.supplierId) : QVariant();
+        return order.supplierName;
+    case ProductColumn:
+        if (role == Qt::EditRole)
+            return order.productId ? QVariant(order.productId) : QVariant();
+        return order.productName;
+    case YearColumn:
+        return order.year;
+    case RatingColumn:
+        return order.rating;
+    }
+
+    return QVariant();
+}
+
+bool OrderTableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::EditRole || !(flags(index) & Qt::ItemIsEditable))
+        return false;
+
+    // the mapper submits all its widgets, not only the one that changed
+    if (index.data(Qt::EditRole) == value)
+        return true;
+
+    return updateRows(QList<int>() << index.row(), index.column(), value);
+}
+
+QVariant OrderTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section) {
+    case IdColumn:
+        return tr("Id");
+    case NameColumn:
+        return tr("Name");
+    case SupplierColumn:
+        return tr("Supplier");
+    case ProductColumn:
+        return tr("Product");
+    case YearColumn:
+        return tr("Year");
+    case RatingColumn:
+        return tr("Rating");
+    }
+
+    return QVariant();
+}
+
+Qt::ItemFlags OrderTableModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags flags = QAbstractTableModel::flags(index);
+    if (index.isValid() && index.column() != IdColumn)
+        flags |= Qt::ItemIsEditable;
+    return flags;
+}
+
+bool OrderTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !atEnd_;
+}
+
+void OrderTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || atEnd_)
+        return;
+
+    // keyset pagination: continue right after the last row we already have
+    QVector<OrderRow> page;
+    lastError_ = loadOrders(DbRouter::loaderDatabase(), year_,
+                            orders_.isEmpty() ? 0 : &orders_.last(), PageSize, page);
+    if (lastError_.type() != QSqlError::NoError) {
+        // the next scroll or select() tries again
+        emit loadFailed(lastError_);
+        return;
+    }
+
+    atEnd_ = page.size() < PageSize;
+    if (page.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), orders_.size(), orders_.size() + page.size() - 1);
+    orders_ += page;
+    for (const OrderRow &order : page)
+        bytes_ += orderSize(order);
+    endInsertRows();
+
+    MemoryBudget::instance()->touch(this);
+    MemoryBudget::instance()->scheduleEnforce();
+}
+
+bool OrderTableModel::select()
+{
+    // Read our own writes: the connection may have moved to the primary
+    // (or back to the replica), the relation models must follow it
+    const bool moved = DbRouter::refreshModelDatabase();
+    for (int column : { SupplierColumn, ProductColumn }) {
+        QSqlTableModel *model = relationModel(column);
+        if ((moved || !model->query().isActive()) && !model->select()) {
+            lastError_ = model->lastError();
+            return false;
+        }
+    }
+
+    beginResetModel();
+    orders_.clear();
+    bytes_ = 0;
+    atEnd_ = false;
+    hotRow_ = 0;
+    lastError_ = QSqlError();
+    endResetModel();
+
+    fetchMore(QModelIndex());
+    return lastError_.type() == QSqlError::NoError;
+}
+
+int OrderTableModel::keptRows() const
+{
+    // the page of the hot row, the ones above it and one more below: the
+    // view fetches again as soon as its last row is the model's last one
+    return (qMax(0, hotRow_) / PageSize + 2) * PageSize;
+}
+
+qint64 OrderTableModel::evictableMemory() const
+{
+    qint64 bytes = 0;
+    for (int row = keptRows(); row < orders_.size(); ++row)
+        bytes += orderSize(orders_.at(row));
+    return bytes;
+}
+
+qint64 OrderTableModel::evictMemory(qint64 bytes)
+{
+    const int keep = keptRows();
+    if (orders_.size() <= keep)
+        return 0;
+
+    int first = orders_.size();
+    qint64 freed = 0;
+    while (first > keep && freed < bytes) {
+        const int end = first;
+        first = qMax(keep, first - PageSize);
+        for (int row = first; row < end; ++row)
+            freed += orderSize(orders_.at(row));
+    }
+
+    beginRemoveRows(QModelIndex(), first, orders_.size() - 1);
+    orders_.resize(first);
+    bytes_ -= freed;
+    atEnd_ = false;
+    endRemoveRows();
+
+    return freed;
+}
+
+QString OrderTableModel::relationName(int column, const QVariant &id) const
+{
+    QSqlTableModel *model = relationModel(column);
+    if (!model || id.isNull())
+        return QString();
+
+    const int idColumn = model->fieldIndex("id");
+    const int nameColumn = model->fieldIndex("name");
+    for (int row = 0; row < model->rowCount(); ++row) {
+        if (model->index(row, idColumn).data() == id)
+            return model->index(row, nameColumn).data().toString();
+    }
+
+    return QString();
+}
+
+void OrderTableModel::setValue(OrderRow &order, int column, const QVariant &value,
+                               const QVariant &displayValue)
+{
+    switch (column) {
+    case NameColumn:
+        order.name = value.toString();
+        break;
+    case SupplierColumn:
+        order.supplierId = value.toInt();
+        order.supplierName = displayValue.toString();
+        break;
+    case ProductColumn:
+        order.productId = value.toInt();
+        order.productName = displayValue.toString();
+        break;
+    case YearColumn:
+        order.year = value.toInt();
+        break;
+    case RatingColumn:
+        order.rating = value.toInt();
+        break;
+    }
+}
+
+qint64 OrderTableModel::orderSize(const OrderRow &order)
+{
+    return sizeof(OrderRow)
+            + (order.name.capacity() + order.supplierName.capacity() + order.productName.capacity())
+            * sizeof(QChar);
+}
@@ -0,0 +1,112 @@
+#ifndef ORDERTABLEMODEL_H
+#define ORDERTABLEMODEL_H
+
+#include <memory>
+#include <QAbstractTableModel>
+#include <QSqlError>
+#include <QVariant>
+#include <QVector>
+
+#include "binaryloader.h"
+#include "memorybudget.h"
+
+class QSqlTableModel;
+
+/*
+ * Model of the orders table. The rows are read in pages by loadOrders()
+ * (see binaryloader.h), with keyset pagination on (id, year), into typed
+ * columns that already hold the supplier and product names.
+ *
+ * The writes are explicit statements on the primary (see DbRouter): an
+ * edit of a cell or a column of many rows is one UPDATE, then the loaded
+ * rows are patched in place instead of being read again.
+ *
+ * The supplier and product relations are QSqlTableModels on
+ * DbRouter::modelDatabase(), for the combo boxes that edit them.
+ *
+ * Under memory pressure the pages of orders after the hot row are
+ * dropped and fetched again when the view scrolls down to them, and the
+ * relation models no widget uses are cleared until relationModel() is
+ * asked for them.
+ */
+class OrderTableModel : public QAbstractTableModel, public MemoryAccount
+{
+    Q_OBJECT
+
+public:
+    // Same order as the columns of the orders table (see initdb.h)
+    enum Column { IdColumn, NameColumn, SupplierColumn, ProductColumn, YearColumn, RatingColumn,
+                  ColumnCount };
+
+    explicit OrderTableModel(QObject *parent = 0);
+
+    // Shows the orders of one year only when year is valid, of all the
+    // years otherwise. Selects the orders again.
+    bool setYear(const QVariant &year);
+    QVariant year() const { return year_; }
+
+    QSqlError lastError() const { return lastError_; }
+
+    // The suppliers or products table model of a relation column, 0 for
+    // the other columns. It is selected again if it was evicted.
+    QSqlTableModel *relationModel(int column) const;
+
+    // Last row the view shows or has selected, see lastHotRow() in tools.h.
+    // Its page, the ones above it and the next one are never evicted.
+    void setHotRow(int row) { hotRow_ = row; }
+
+    // displayValue is what the views show, e.g. the supplier name of a
+    // relation column; it defaults to the name of the related row.
+    bool updateRows(const QList<int> &rows, int column, const QVariant &value,
+                    const QVariant &displayValue = QVariant());
+
+    // Inserts an order on the primary. *row is its row in the model, or -1
+    // when it is not shown (another year) or not loaded yet (the pages
+    // before it are not).
+    bool insertOrder(const QString &name, int year, const QVariant &supplierId,
+                     const QVariant &productId, int rating, int *row = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) Q_DECL_OVERRIDE;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    Qt::ItemFlags flags(const QModelIndex &index) const Q_DECL_OVERRIDE;
+
+    bool canFetchMore(const QModelIndex &parent) const Q_DECL_OVERRIDE;
+    void fetchMore(const QModelIndex &parent) Q_DECL_OVERRIDE;
+
+    QString memoryName() const Q_DECL_OVERRIDE { return tr("Orders"); }
+    qint64 memoryUsage() const Q_DECL_OVERRIDE { return bytes_; }
+    qint64 evictableMemory() const Q_DECL_OVERRIDE;
+    qint64 evictMemory(qint64 bytes) Q_DECL_OVERRIDE;
+
+    static const int PageSize = 256;
+
+public slots:
+    bool select();
+
+signals:
+    // A page of orders could not be loaded, see lastError()
+    void loadFailed(const QSqlError &error);
+
+private:
+    int keptRows() const;
+    QString relationName(int column, const QVariant &id) const;
+    void setValue(OrderRow &order, int column, const QVariant &value, const QVariant &displayValue);
+    static qint64 orderSize(const OrderRow &order);
+
+    QVector<OrderRow> orders_;
+    QVariant year_;
+    bool atEnd_;
+    qint64 bytes_;
+    int hotRow_;
+    QSqlError lastError_;
+    QSqlTableModel *suppliers_;
+    QSqlTableModel *products_;
+    std::unique_ptr<MemoryAccount> suppliersAccount_;
+    std::unique_ptr<MemoryAccount> productsAccount_;
+};
+
+#endif // ORDERTABLEMODEL_H
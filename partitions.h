@@ -0,0 +1,154 @@
+#ifndef PARTITIONS_H
+#define PARTITIONS_H
+
+#include <algorithm>
+#include <QtSql>
+
+/*
+ * orders is range partitioned on year and order_items on order_year
+ * (see initdb.h). Each year lives in a pair of partitions named
+ * orders_y<year> and order_items_y<year>; rows of any other year go to
+ * the default partitions.
+ */
+
+inline bool hasOrderPartition(int year, QSqlDatabase db = QSqlDatabase::database())
+{
+    QSqlQuery q(db);
+    return q.exec(QString("SELECT to_regclass('orders_y%1') IS NOT NULL").arg(year))
+            && q.next() && q.value(0).toBool();
+}
+
+// Creating the partition of a year the default partition holds rows of
+// fails, after scanning the default partition under an exclusive lock:
+// check this first, it only reads.
+inline bool defaultPartitionHasYear(int year, QSqlDatabase db = QSqlDatabase::database())
+{
+    QSqlQuery q(db);
+    return q.exec(QString("SELECT EXISTS (SELECT 1 FROM orders_default WHERE year = %1)").arg(year))
+            && q.next() && q.value(0).toBool();
+}
+
+// Both partitions of the year are created, or none
+inline QSqlError createOrderPartition(int year)
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.transaction())
+        return db.lastError();
+
+    const QStringList statements = QStringList()
+        << QString("CREATE TABLE IF NOT EXISTS orders_y%1 PARTITION OF orders "
+                   "FOR VALUES FROM (%1) TO (%2)").arg(year).arg(year + 1)
+        << QString("CREATE TABLE IF NOT EXISTS order_items_y%1 PARTITION OF order_items "
+                   "FOR VALUES FROM (%1) TO (%2)").arg(year).arg(year + 1);
+
+    QSqlQuery q;
+    for (const QString &statement : statements) {
+        if (!q.exec(statement)) {
+            QSqlError err = q.lastError();
+            db.rollback();
+            return err;
+        }
+    }
+
+    if (!db.commit())
+        return db.lastError();
+
+    return QSqlError();
+}
+
+/*
+ * Moves the orders of a year, with their items, out of the default
+ * partitions into partitions of their own. The new partitions are filled
+ * as plain tables and attached last: the orders must be there before the
+ * foreign key of the items is checked.
+ */
+inline QSqlError splitOrderPartition(int year)
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.transaction())
+        return db.lastError();
+
+    const QString range = QString("FOR VALUES FROM (%1) TO (%2)").arg(year).arg(year + 1);
+    const QStringList statements = QStringList()
+        << QString("CREATE TABLE orders_y%1 (LIKE orders INCLUDING DEFAULTS INCLUDING CONSTRAINTS)").arg(year)
+        << QString("CREATE TABLE order_items_y%1 (LIKE order_items INCLUDING DEFAULTS INCLUDING CONSTRAINTS)").arg(year)
+        << QString("INSERT INTO orders_y%1 SELECT * FROM orders_default WHERE year = %1").arg(year)
+        << QString("INSERT INTO order_items_y%1 SELECT * FROM order_items_default WHERE order_year = %1").arg(year)
+        << QString("DELETE FROM order_items_default WHERE order_year = %1").arg(year)
+        << QString("DELETE FROM orders_default WHERE year = %1").arg(year)
+        << QString("ALTER TABLE orders ATTACH PARTITION orders_y%1 %2").arg(year).arg(range)
+        << QString("ALTER TABLE order_items ATTACH PARTITION order_items_y%1 %2").arg(year).arg(range);
+
+    QSqlQuery q;
+    for (const QString &statement : statements) {
+        if (!q.exec(statement)) {
+            QSqlError err = q.lastError();
+            db.rollback();
+            return err;
+        }
+    }
+
+    if (!db.commit())
+        return db.lastError();
+
+    return QSqlError();
+}
+
+inline QList<int> orderPartitionYears(QSqlDatabase db = QSqlDatabase::database())
+{
+    QList<int> years;
+
+    QSqlQuery q(db);
+    if (!q.exec(QLatin1String("SELECT c.relname FROM pg_inherits i JOIN pg_class c ON c.oid = i.inhrelid "
+                              "WHERE i.inhparent = to_regclass('orders')")))
+        return years;
+
+    const QString prefix = QLatin1String("orders_y");
+    while (q.next()) {
+        const QString name = q.value(0).toString();
+        bool ok = false;
+        int year = name.mid(prefix.size()).toInt(&ok);
+        if (name.startsWith(prefix) && ok)
+            years.append(year);
+    }
+    std::sort(years.begin(), years.end());
+
+    return years;
+}
+
+/*
+ * Detach the partitions of a year and move them to the archive schema.
+ * Detaching only changes the catalog: no rows are copied or deleted, so
+ * there is nothing to vacuum afterwards and the tables are locked briefly.
+ */
+inline QSqlError archiveOrderPartition(int year)
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.transaction())
+        return db.lastError();
+
+    const QStringList statements = QStringList()
+        << QLatin1String("CREATE SCHEMA IF NOT EXISTS archive")
+        << QString("ALTER TABLE order_items DETACH PARTITION order_items_y%1").arg(year)
+        // the detached items must not keep the archived orders referenced
+        << QString("ALTER TABLE order_items_y%1 DROP CONSTRAINT IF EXISTS order_items_order_fkey").arg(year)
+        << QString("ALTER TABLE orders DETACH PARTITION orders_y%1").arg(year)
+        << QString("ALTER TABLE order_items_y%1 SET SCHEMA archive").arg(year)
+        << QString("ALTER TABLE orders_y%1 SET SCHEMA archive").arg(year);
+
+    QSqlQuery q;
+    for (const QString &statement : statements) {
+        if (!q.exec(statement)) {
+            QSqlError err = q.lastError();
+            db.rollback();
+            return err;
+        }
+    }
+
+    if (!db.commit())
+        return db.lastError();
+
+    return QSqlError();
+}
+
+#endif // PARTITIONS_H
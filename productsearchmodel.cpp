@@ -0,0 +1,160 @@
+#include <QtSql>
+#include "dbrouter.h"
+#include "productsearchmodel.h"
+
+namespace {
+
+// The expression covered by products_name_key_idx (see initdb.h)
+const char *const NameKey = "lower(name) COLLATE \"C\"";
+
+QString likePrefix(const QString &prefix)
+{
+    QString escaped = prefix.toLower();
+    escaped.replace('\\', "\\\\");
+    escaped.replace('%', "\\%");
+    escaped.replace('_', "\\_");
+    return escaped + '%';
+}
+
+}
+
+ProductSearchModel::ProductSearchModel(QObject *parent) :
+    QAbstractListModel(parent),
+    atEnd_(false),
+    bytes_(0),
+    hotRow_(0)
+{
+    MemoryBudget::instance()->addAccount(this);
+}
+
+void ProductSearchModel::setPrefix(const QString &prefix)
+{
+    beginResetModel();
+    prefix_ = prefix;
+    products_.clear();
+    atEnd_ = false;
+    bytes_ = 0;
+    hotRow_ = 0;
+    endResetModel();
+}
+
+QVariant ProductSearchModel::productId(int row) const
+{
+    if (row < 0 || row >= products_.size())
+        return QVariant();
+
+    return products_.at(row).id;
+}
+
+int ProductSearchModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : products_.size();
+}
+
+QVariant ProductSearchModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= products_.size())
+        return QVariant();
+
+    const Product &product = products_.at(index.row());
+    if (role == Qt::DisplayRole || role == Qt::EditRole)
+        return product.name;
+    if (role == Qt::UserRole)
+        return product.id;
+
+    return QVariant();
+}
+
+bool ProductSearchModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !atEnd_;
+}
+
+void ProductSearchModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || atEnd_)
+        return;
+
+    QString sql = QString("SELECT id, name, lower(name) FROM products WHERE %1 LIKE ?").arg(NameKey);
+    // keyset pagination: continue right after the last row we already have
+    if (!products_.isEmpty())
+        sql += QString(" AND (%1, id) > (?, ?)").arg(NameKey);
+    sql += QString(" ORDER BY %1, id LIMIT %2").arg(NameKey).arg(PageSize);
+
+    QSqlQuery q(DbRouter::readDatabase());
+    q.setForwardOnly(true);
+    q.prepare(sql);
+    q.addBindValue(likePrefix(prefix_));
+    if (!products_.isEmpty()) {
+        q.addBindValue(products_.last().key);
+        q.addBindValue(products_.last().id);
+    }
+
+    if (!q.exec()) {
+        qDebug() << Q_FUNC_INFO << q.lastError().text();
+        atEnd_ = true;
+        return;
+    }
+
+    QVector<Product> page;
+    page.reserve(PageSize);
+    while (q.next())
+        page.append(Product{ q.value(0).toInt(), q.value(1).toString(), q.value(2).toString() });
+
+    atEnd_ = page.size() < PageSize;
+    if (page.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), products_.size(), products_.size() + page.size() - 1);
+    products_ += page;
+    for (const Product &product : page)
+        bytes_ += productSize(product);
+    endInsertRows();
+
+    MemoryBudget::instance()->touch(this);
+    MemoryBudget::instance()->scheduleEnforce();
+}
+
+int ProductSearchModel::keptRows() const
+{
+    // the page of the hot row, the ones above it and one more below: the
+    // view fetches again as soon as its last row is the model's last one
+    return (qMax(0, hotRow_) / PageSize + 2) * PageSize;
+}
+
+qint64 ProductSearchModel::evictableMemory() const
+{
+    qint64 bytes = 0;
+    for (int row = keptRows(); row < products_.size(); ++row)
+        bytes += productSize(products_.at(row));
+    return bytes;
+}
+
+qint64 ProductSearchModel::evictMemory(qint64 bytes)
+{
+    const int keep = keptRows();
+    if (products_.size() <= keep)
+        return 0;
+
+    int first = products_.size();
+    qint64 freed = 0;
+    while (first > keep && freed < bytes) {
+        const int end = first;
+        first = qMax(keep, first - PageSize);
+        for (int row = first; row < end; ++row)
+            freed += productSize(products_.at(row));
+    }
+
+    beginRemoveRows(QModelIndex(), first, products_.size() - 1);
+    products_.resize(first);
+    bytes_ -= freed;
+    atEnd_ = false;
+    endRemoveRows();
+
+    return freed;
+}
+
+qint64 ProductSearchModel::productSize(const Product &product)
+{
+    return sizeof(Product) + (product.name.capacity() + product.key.capacity()) * sizeof(QChar);
+}
@@ -0,0 +1,66 @@
+#ifndef PRODUCTSEARCHMODEL_H
+#define PRODUCTSEARCHMODEL_H
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+
+#include "memorybudget.h"
+
+/*
+ * List model for the products table that never loads the whole catalog.
+ * Rows matching a name prefix are fetched in pages, ordered by the
+ * indexed expression lower(name) (see initdb.h), using keyset pagination
+ * so that every page costs the same whatever the catalog size.
+ *
+ * Under memory pressure the pages after the hot row are dropped, they are
+ * fetched again when the view scrolls down to them.
+ */
+class ProductSearchModel : public QAbstractListModel, public MemoryAccount
+{
+    Q_OBJECT
+
+public:
+    explicit ProductSearchModel(QObject *parent = 0);
+
+    void setPrefix(const QString &prefix);
+    QString prefix() const { return prefix_; }
+
+    // Returns the products.id of the given row, or an invalid QVariant
+    QVariant productId(int row) const;
+
+    // Last row the view shows or has selected, see lastHotRow() in tools.h.
+    // Its page, the ones above it and the next one are never evicted.
+    void setHotRow(int row) { hotRow_ = row; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+
+    bool canFetchMore(const QModelIndex &parent) const Q_DECL_OVERRIDE;
+    void fetchMore(const QModelIndex &parent) Q_DECL_OVERRIDE;
+
+    QString memoryName() const Q_DECL_OVERRIDE { return tr("Products search"); }
+    qint64 memoryUsage() const Q_DECL_OVERRIDE { return bytes_; }
+    qint64 evictableMemory() const Q_DECL_OVERRIDE;
+    qint64 evictMemory(qint64 bytes) Q_DECL_OVERRIDE;
+
+    static const int PageSize = 100;
+
+private:
+    struct Product {
+        int id;
+        QString name;
+        QString key; // lower(name), the keyset cursor
+    };
+
+    int keptRows() const;
+    static qint64 productSize(const Product &product);
+
+    QString prefix_;
+    QVector<Product> products_;
+    bool atEnd_;
+    qint64 bytes_;
+    int hotRow_;
+};
+
+#endif // PRODUCTSEARCHMODEL_H
@@ -0,0 +1,38 @@
+# Sources shared by the application and the benchmark (see bench/uibench.pro)
+INCLUDEPATH += $$PWD
+
+HEADERS     += $$PWD/bookdelegate.h $$PWD/initdb.h \
+    $$PWD/mainwindow.h \
+    $$PWD/addorderwindow.h \
+    $$PWD/binaryloader.h \
+    $$PWD/dbrouter.h \
+    $$PWD/memorybudget.h \
+    $$PWD/orderitemsmodel.h \
+    $$PWD/ordertablemodel.h \
+    $$PWD/partitions.h \
+    $$PWD/productsearchmodel.h \
+    $$PWD/tools.h
+RESOURCES   += \
+    $$PWD/tarod_forms.qrc
+SOURCES     += $$PWD/bookdelegate.cpp \
+    $$PWD/mainwindow.cpp \
+    $$PWD/addorderwindow.cpp \
+    $$PWD/binaryloader.cpp \
+    $$PWD/dbrouter.cpp \
+    $$PWD/memorybudget.cpp \
+    $$PWD/orderitemsmodel.cpp \
+    $$PWD/ordertablemodel.cpp \
+    $$PWD/productsearchmodel.cpp
+FORMS       += \
+    $$PWD/mainwindow.ui \
+    $$PWD/addorderwindow.ui
+
+QT += sql widgets
+
+# binary result loader (see binaryloader.h)
+unix {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libpq
+} else {
+    LIBS += -lpq
+}
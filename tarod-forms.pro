@@ -1,20 +1,8 @@
 TEMPLATE = app
 INCLUDEPATH += .
 
-HEADERS     = bookdelegate.h initdb.h \
-    mainwindow.h \
-    addorderwindow.h \
-    tools.h
-RESOURCES   = \
-    tarod_forms.qrc
-SOURCES     = bookdelegate.cpp main.cpp \
-    mainwindow.cpp \
-    addorderwindow.cpp
-FORMS       = \
-    mainwindow.ui \
-    addorderwindow.ui
+include(tarod-forms.pri)
 
-QT += sql widgets widgets
+SOURCES     += main.cpp
 
 DISTFILES +=
-
@@ -1,7 +1,9 @@
 #ifndef TOOLS
 #define TOOLS
 
+#include <QAbstractItemView>
 #include <QMessageBox>
+#include <QScrollBar>
 
 inline void showInfo(const QString &info)
 {
@@ -10,6 +12,33 @@ inline void showInfo(const QString &info)
                              info);
 }
 
+// Last row the view shows, has as current or has selected
+inline int lastHotRow(const QAbstractItemView *view)
+{
+    const QModelIndex bottom = view->indexAt(view->viewport()->rect().bottomLeft());
+    int row = bottom.isValid() ? bottom.row() : view->model()->rowCount() - 1;
+
+    if (const QItemSelectionModel *selection = view->selectionModel()) {
+        row = qMax(row, selection->currentIndex().row());
+        for (const QItemSelectionRange &range : selection->selection())
+            row = qMax(row, range.bottom());
+    }
+
+    return row;
+}
+
+// Keeps model->setHotRow() up to date with lastHotRow(view), for the
+// models that evict their rows under memory pressure (see memorybudget.h).
+// The view must already have its model.
+template <typename Model>
+void trackHotRow(QAbstractItemView *view, Model *model)
+{
+    auto update = [view, model]() { model->setHotRow(lastHotRow(view)); };
+    QObject::connect(view->verticalScrollBar(), &QScrollBar::valueChanged, model, update);
+    QObject::connect(view->selectionModel(), &QItemSelectionModel::currentChanged, model, update);
+    QObject::connect(view->selectionModel(), &QItemSelectionModel::selectionChanged, model, update);
+    QObject::connect(model, &QAbstractItemModel::rowsInserted, model, update);
+}
 
 #endif // TOOLS
 